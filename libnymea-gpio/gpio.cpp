@@ -85,6 +85,40 @@
 
         qDebug() << "Current value" << gpioIn->value();
     \endcode
+
+    By default every call of \l{setValue()} and \l{value()} opens the \tt value file of the GPIO, accesses it and closes it again.
+    For GPIOs which get accessed very frequently, i.e. bit-banged status LEDs or relays, the \tt value file can be kept open
+    for the life time of the object using \l{setPersistentValueFile()}. In that case a value access is a single \tt pwrite or \tt pread
+    of one byte at offset 0. If the persistent file becomes unusable, i.e. because the GPIO got unexported from somewhere else,
+    the access falls back to the per-call behaviour. The file will be closed and opened again on the next \l{exportGpio()} or
+    \l{setPersistentValueFile()}, since value accesses of other threads might still be using it.
+
+    The configuration of the Gpio (\l{direction()}, \l{activeLow()} and \l{edgeInterrupt()}) will be cached once it has been
+    written or read by this object, so reading it again does not access the kernel. If the configuration might have been
+    changed from outside of this object, the cache can be updated using \l{refresh()} or discarded using \l{invalidateCache()}.
+    The value of a Gpio will never be cached.
+
+    For control loops which apply the same configuration and values over and over again, the write elision mode
+    (\l{setWriteElision()}) compares each write against the cached state and skips it if nothing would change. The
+    \l{elidedWrites()} and \l{performedWrites()} counters show how many kernel accesses have been saved.
+
+    Each Gpio counts its reads, writes and failed kernel accesses. The counters are always enabled and cost one
+    increment per access, a snapshot can be taken using \l{statistics()}.
+
+    The actual I/O will be performed by a \l{GpioBackend}. If a GPIO character device \tt {/dev/gpiochipN} is available, the
+    GPIO v2 line request interface will be used. Otherwise the legacy sysfs interface \tt {/sys/class/gpio} will be used.
+
+    \chapter Thread safety
+
+    The values of a Gpio can be written using \l{setValue()} and read using \l{value()} from any thread at the
+    same time without taking a lock. The configuration methods are serialized internally. While the configuration
+    gets changed, the value accesses of other threads wait until the change has been finished, so a value will never be
+    written with a half applied configuration.
+
+    The Gpio has to be exported before it is shared with other threads, and all threads have to be done with it before
+    it gets unexported or deleted. If several threads write different values with \l{setWriteElision()} enabled,
+    writes might be skipped depending on the order in which the threads reach the kernel.
+
     \sa GpioMonitor
 */
 
@@ -128,31 +162,166 @@
         The Gpio does not react on interrupts.
 */
 
+/*!
+    \enum Gpio::Backend
+    This enum type specifies the kernel interface used to access a Gpio.
+
+    \value BackendAuto
+        The character device interface will be used if available, otherwise the sysfs interface.
+    \value BackendSysfs
+        The legacy \tt {/sys/class/gpio} interface.
+    \value BackendCharacterDevice
+        The GPIO character device \tt {/dev/gpiochipN} interface.
+    \value BackendMock
+        An in-memory simulation of the GPIO without any hardware access, see \l{GpioMockBackend}.
+*/
+
 #include "gpio.h"
+#include "gpiobackend.h"
+#include "gpiosysfsbackend.h"
+#include "gpiochardevbackend.h"
+#include "gpiomockbackend.h"
+#include "gpiochipinfo.h"
+#include "gpiotrace.h"
+
+#include <QThread>
 
 Q_LOGGING_CATEGORY(dcGpio, "Gpio")
 
-/*! Constructs a Gpio object to represent a GPIO with the given \a gpio number and \a parent. */
+// Value accesses do not lock, unless a configuration change is in progress
+class GpioValueAccess
+{
+public:
+    explicit GpioValueAccess(Gpio *gpio) :
+        m_gpio(gpio)
+    {
+        m_gpio->m_valueAccesses.fetchAndAddOrdered(1);
+        if (m_gpio->m_configuring.loadAcquire()) {
+            // Wait until the configuration has been changed
+            m_gpio->m_valueAccesses.fetchAndAddOrdered(-1);
+            m_gpio->m_configurationMutex.lock();
+            m_locked = true;
+        }
+    }
+
+    ~GpioValueAccess()
+    {
+        if (m_locked) {
+            m_gpio->m_configurationMutex.unlock();
+        } else {
+            m_gpio->m_valueAccesses.fetchAndAddOrdered(-1);
+        }
+    }
+
+private:
+    Gpio *m_gpio = nullptr;
+    bool m_locked = false;
+
+};
+
+// Serializes the configuration changes and waits until running value accesses are done with the backend
+class GpioConfigurationLocker
+{
+public:
+    explicit GpioConfigurationLocker(Gpio *gpio) :
+        m_gpio(gpio)
+    {
+        m_gpio->m_configurationMutex.lock();
+        if (m_gpio->m_configurationDepth++ == 0) {
+            m_gpio->m_configuring.fetchAndStoreOrdered(1);
+            while (m_gpio->m_valueAccesses.loadAcquire() > 0)
+                QThread::yieldCurrentThread();
+        }
+    }
+
+    ~GpioConfigurationLocker()
+    {
+        if (--m_gpio->m_configurationDepth == 0)
+            m_gpio->m_configuring.fetchAndStoreOrdered(0);
+
+        m_gpio->m_configurationMutex.unlock();
+    }
+
+private:
+    Gpio *m_gpio = nullptr;
+
+};
+
+/*! Constructs a Gpio object to represent a GPIO with the given \a gpio number and \a parent. The backend will be selected automatically. */
 Gpio::Gpio(int gpio, QObject *parent) :
+    Gpio(gpio, Gpio::BackendAuto, parent)
+{
+
+}
+
+/*! Constructs a Gpio object to represent a GPIO with the given \a gpio number and \a parent using the given \a backend. */
+Gpio::Gpio(int gpio, Gpio::Backend backend, QObject *parent) :
     QObject(parent),
     m_gpio(gpio),
+    m_gpioDirectory(QDir(QString("%1/gpio%2").arg(GpioSysfsBackend::sysfsPath()).arg(QString::number(gpio)))),
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    m_configurationMutex(QMutex::Recursive),
+#endif
     m_direction(Gpio::DirectionInvalid),
-    m_gpioDirectory(QDir(QString("/sys/class/gpio/gpio%1").arg(QString::number(gpio))))
+    m_lastValue(Gpio::ValueInvalid),
+    m_requestedBackend(backend)
 {
     qRegisterMetaType<Gpio::Value>();
 
+    m_backend = GpioBackend::create(m_gpio, m_requestedBackend);
+}
+
+/*! Constructs a Gpio object to represent the GPIO line with the given \a lineName and \a parent. The backend will be selected automatically.
+
+    The line will be looked up using \l{GpioChipInfo::gpioNumber()}. If no line with this name exists, the \l{gpioNumber()} will
+    be -1 and exporting the Gpio will fail.
+*/
+Gpio::Gpio(const QString &lineName, QObject *parent) :
+    Gpio(GpioChipInfo::gpioNumber(lineName), Gpio::BackendAuto, parent)
+{
+
+}
+
+/*! Constructs a Gpio object to represent the GPIO line with the given \a lineName and \a parent using the given \a backend.
+
+    \sa GpioChipInfo::gpioNumber()
+*/
+Gpio::Gpio(const QString &lineName, Gpio::Backend backend, QObject *parent) :
+    Gpio(GpioChipInfo::gpioNumber(lineName), backend, parent)
+{
+
 }
 
 /*! Destroys and unexports the Gpio. */
 Gpio::~Gpio()
 {
     unexportGpio();
+    delete m_backend;
 }
 
-/*! Returns true if the directories \tt {/sys/class/gpio} and \tt {/sys/class/gpio/export} do exist. */
+/*! Returns true if the GPIO character devices \tt {/dev/gpiochipN} or the file \tt {/sys/class/gpio/export} do exist,
+    or if the \l{GpioMockBackend}{mock backend} has been selected using \tt NYMEA_GPIO_BACKEND. */
 bool Gpio::isAvailable()
 {
-    return QFile("/sys/class/gpio/export").exists();
+    if (GpioBackend::availableBackend() == Gpio::BackendMock)
+        return true;
+
+    return GpioChardevBackend::isAvailable() || GpioSysfsBackend::isAvailable();
+}
+
+/*! Returns the type of the backend used by this Gpio.
+
+    \sa GpioBackend
+*/
+Gpio::Backend Gpio::backendType() const
+{
+    return m_backend->type();
+}
+
+/*! Returns the backend used by this Gpio. The backend is owned by this Gpio. */
+GpioBackend *Gpio::backend() const
+{
+    return m_backend;
 }
 
 /*! Returns the directory \tt {/sys/class/gpio/gpio<number>} of this Gpio. */
@@ -169,107 +338,106 @@ int Gpio::gpioNumber() const
     return m_gpio;
 }
 
-/*! Returns true if this Gpio could be exported in the system file \tt {/sys/class/gpio/export}. If this Gpio is already exported, this function will return true. */
+/*! Returns true if this Gpio could be exported. If this Gpio is already exported, this function will return true.
+
+    Using the sysfs backend, the Gpio will be exported in the system file \tt {/sys/class/gpio/export}. Using the character device
+    backend, the line of this Gpio will be requested. If the automatically selected character device backend could not request the line,
+    i.e. because the GPIO is already exported using sysfs, this Gpio falls back to the sysfs backend.
+*/
 bool Gpio::exportGpio()
 {
     qCDebug(dcGpio()) << "Export GPIO" << m_gpio;
-    // Check if already exported
-    if (m_gpioDirectory.exists()) {
-        qCDebug(dcGpio()) << "GPIO" << m_gpio << "already exported.";
+    GpioConfigurationLocker locker(this);
+    invalidateCache();
+    if (m_backend->exportGpio())
         return true;
-    }
 
-    QFile exportFile("/sys/class/gpio/export");
-    if (!exportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO export file:" << exportFile.errorString();
-        return false;
+    if (m_requestedBackend == Gpio::BackendAuto && m_backend->type() == Gpio::BackendCharacterDevice && GpioSysfsBackend::isAvailable()) {
+        qCDebug(dcGpio()) << "Falling back to the sysfs backend for GPIO" << m_gpio;
+        delete m_backend;
+        m_backend = new GpioSysfsBackend(m_gpio);
+        m_backend->setPersistentValueFile(m_persistentValueFile);
+        m_backend->setExportTimeout(m_exportTimeout);
+        if (m_backend->exportGpio())
+            return true;
     }
 
-    QTextStream out(&exportFile);
-    out << m_gpio;
-    exportFile.close();
-    return true;
+    m_errors++;
+    return false;
 }
 
-/*! Returns true if this Gpio could be unexported in the system file \tt {/sys/class/gpio/unexport}. */
+/*! Returns true if this Gpio could be unexported in the system file \tt {/sys/class/gpio/unexport} or the line request could be released. */
 bool Gpio::unexportGpio()
 {
     qCDebug(dcGpio()) << "Unexport GPIO" << m_gpio;
-
-    QFile unexportFile("/sys/class/gpio/unexport");
-    if (!unexportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO unexport file:" << unexportFile.errorString();
+    GpioConfigurationLocker locker(this);
+    invalidateCache();
+    if (!m_backend->unexportGpio()) {
+        m_errors++;
         return false;
     }
 
-    QTextStream out(&unexportFile);
-    out << m_gpio;
-    unexportFile.close();
     return true;
 }
 
 /*! Returns true if the \a direction of this GPIO could be set. \sa Gpio::Direction, */
 bool Gpio::setDirection(Gpio::Direction direction)
 {
-    qCDebug(dcGpio()) << "Set GPIO" << m_gpio << "direction" << direction;
+    GPIO_TRACE(GpioTrace::PointSetDirection, m_gpio, direction);
     if (direction == Gpio::DirectionInvalid) {
         qCWarning(dcGpio()) << "Setting an invalid direction is forbidden.";
         return false;
     }
 
-    QFile directionFile(m_gpioDirectory.path() + QDir::separator() + "direction");
-    if (!directionFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "direction file:" << directionFile.errorString();
-        return false;
+    GpioConfigurationLocker locker(this);
+    if (m_writeElision.loadAcquire() && m_direction.loadAcquire() == direction) {
+        m_elidedWrites++;
+        return true;
     }
 
-    m_direction = direction;
-
-    QTextStream out(&directionFile);
-    switch (m_direction) {
-    case DirectionInput:
-        out << "in";
-        break;
-    case DirectionOutput:
-        out << "out";
-        break;
-    default:
-        break;
+    m_performedWrites++;
+    if (!m_backend->setDirection(direction)) {
+        m_errors++;
+        invalidateCache();
+        return false;
     }
 
-    directionFile.close();
+    m_direction.storeRelease(direction);
+    m_lastValue.storeRelease(Gpio::ValueInvalid);
+
+    // Changing the direction resets the edge interrupt of outputs
+    if (direction == Gpio::DirectionOutput) {
+        m_edge = Gpio::EdgeNone;
+        m_edgeCached = true;
+    }
     return true;
 }
 
-/*! Returns the direction of this Gpio. */
+/*! Returns the direction of this Gpio. The direction will be read from the kernel only if it is not cached yet.
+
+    \sa refresh()
+*/
 Gpio::Direction Gpio::direction()
 {
-    QFile directionFile(m_gpioDirectory.path() + QDir::separator() + "direction");
-    if (!directionFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "direction file:" << directionFile.fileName() << directionFile.errorString();
-        return Gpio::DirectionInvalid;
-    }
-
-    QString direction;
-    QTextStream in(&directionFile);
-    in >> direction;
-    directionFile.close();
-
-    if (direction == "in") {
-        m_direction = DirectionInput;
-        return Gpio::DirectionInput;
-    } else if (direction == "out") {
-        m_direction = DirectionOutput;
-        return Gpio::DirectionOutput;
+    int direction = m_direction.loadAcquire();
+    if (direction != Gpio::DirectionInvalid)
+        return static_cast<Gpio::Direction>(direction);
+
+    GpioConfigurationLocker locker(this);
+    if (m_direction.loadAcquire() == Gpio::DirectionInvalid) {
+        m_reads++;
+        m_direction.storeRelease(m_backend->direction());
+        if (m_direction.loadAcquire() == Gpio::DirectionInvalid)
+            m_errors++;
     }
 
-    return Gpio::DirectionInvalid;
+    return static_cast<Gpio::Direction>(m_direction.loadAcquire());
 }
 
 /*! Returns true if the digital \a value of this Gpio could be set correctly. */
 bool Gpio::setValue(Gpio::Value value)
 {
-    qCDebug(dcGpio()) << "Set GPIO" << m_gpio << "value" << value;
+    GPIO_TRACE(GpioTrace::PointSetValue, m_gpio, value);
 
     // Check given value
     if (value == Gpio::ValueInvalid) {
@@ -277,174 +445,295 @@ bool Gpio::setValue(Gpio::Value value)
         return false;
     }
 
+    // The direction is unknown after invalidateCache() or an export, read it again before rejecting the value.
+    // This has to happen before the value access, since reading the direction locks the configuration.
+    if (m_direction.loadAcquire() == Gpio::DirectionInvalid)
+        direction();
+
+    GpioValueAccess access(this);
+
     // Check current direction
-    if (m_direction == Gpio::DirectionInput) {
+    int direction = m_direction.loadAcquire();
+    if (direction == Gpio::DirectionInput) {
         qCWarning(dcGpio()) << "Setting the value of an input GPIO is forbidden.";
         return false;
     }
 
-    if (m_direction == Gpio::DirectionInvalid) {
+    if (direction == Gpio::DirectionInvalid) {
         qCWarning(dcGpio()) << "The direction of GPIO" << m_gpio << "is invalid.";
         return false;
     }
 
-    QFile valueFile(m_gpioDirectory.path() + QDir::separator() + "value");
-    if (!valueFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "value file:" << valueFile.errorString();
-        return false;
+    if (m_writeElision.loadAcquire() && m_lastValue.loadAcquire() == value) {
+        m_elidedWrites++;
+        return true;
     }
 
-    QTextStream out(&valueFile);
-    switch (value) {
-    case ValueLow:
-        out << "0";
-        break;
-    case ValueHigh:
-        out << "1";
-        break;
-    default:
-        valueFile.close();
+    m_performedWrites++;
+    if (!m_backend->setValue(value)) {
+        m_errors++;
+        m_lastValue.storeRelease(Gpio::ValueInvalid);
         return false;
     }
 
-    valueFile.close();
+    m_lastValue.storeRelease(value);
     return true;
 }
 
 /*! Returns the current digital value of this Gpio. */
 Gpio::Value Gpio::value()
 {
-    QFile valueFile(m_gpioDirectory.path() + QDir::separator() + "value");
-    if (!valueFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "value file:" << valueFile.errorString();
-        return Gpio::ValueInvalid;
-    }
-
-    QString value;
-    QTextStream in(&valueFile);
-    in >> value;
-    valueFile.close();
-
-    if (value == "0") {
-        return Gpio::ValueLow;
-    } else if (value == "1") {
-        return Gpio::ValueHigh;
-    }
-
-    return Gpio::ValueInvalid;
+    GpioValueAccess access(this);
+    m_reads++;
+    Gpio::Value value = m_backend->value();
+    if (value == Gpio::ValueInvalid)
+        m_errors++;
+
+    GPIO_TRACE(GpioTrace::PointValue, m_gpio, value);
+    return value;
 }
 
 /*! This method allows to invert the logic of this Gpio. Returns true, if the GPIO could be set \a activeLow. */
 bool Gpio::setActiveLow(bool activeLow)
 {
-    qCDebug(dcGpio()) << "Set GPIO" << m_gpio << "active low" << activeLow;
-
-    QFile activeLowFile(m_gpioDirectory.path() + QDir::separator() + "active_low");
-    if (!activeLowFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "active_low file:" << activeLowFile.errorString();
-        return false;
+    GPIO_TRACE(GpioTrace::PointSetActiveLow, m_gpio, activeLow);
+    GpioConfigurationLocker locker(this);
+    if (m_writeElision.loadAcquire() && m_activeLowCached && m_activeLow == activeLow) {
+        m_elidedWrites++;
+        return true;
     }
 
-    QTextStream out(&activeLowFile);
-    if (activeLow) {
-        out << "1";
-    } else {
-        out << "0";
+    // Inverting the logic inverts the logical value
+    m_lastValue.storeRelease(Gpio::ValueInvalid);
+
+    m_performedWrites++;
+    if (!m_backend->setActiveLow(activeLow)) {
+        m_errors++;
+        m_activeLowCached = false;
+        return false;
     }
 
-    activeLowFile.close();
+    m_activeLow = activeLow;
+    m_activeLowCached = true;
     return true;
 }
 
-/*! Returns true if the logic of this Gpio is inverted (1 = low, 0 = high). */
+/*! Returns true if the logic of this Gpio is inverted (1 = low, 0 = high). The setting will be read from the kernel only
+    if it is not cached yet.
+
+    \sa refresh()
+*/
 bool Gpio::activeLow()
 {
-    QFile activeLowFile(m_gpioDirectory.path() + QDir::separator() + "active_low");
-    if (!activeLowFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "active_low file:" << activeLowFile.errorString();
-        return false;
+    GpioConfigurationLocker locker(this);
+    if (!m_activeLowCached) {
+        m_reads++;
+        m_activeLow = m_backend->activeLow();
+        m_activeLowCached = true;
     }
 
-    QString value;
-    QTextStream in(&activeLowFile);
-    in >> value;
-    activeLowFile.close();
-
-    if (value == "1")
-        return true;
-
-    return false;
+    return m_activeLow;
 }
 
 /*! Returns true if the \a edge of this GPIO could be set correctly. The \a edge parameter specifies, when an interrupt occurs. */
 bool Gpio::setEdgeInterrupt(Gpio::Edge edge)
 {
-
-    if (m_direction == Gpio::DirectionOutput) {
+    GpioConfigurationLocker locker(this);
+    if (m_direction.loadAcquire() == Gpio::DirectionOutput) {
         qCWarning(dcGpio()) << "Could not set edge interrupt, GPIO is configured as an output.";
         return false;
     }
 
-    qCDebug(dcGpio()) << "Set GPIO" << m_gpio << "edge interrupt" << edge;
-    QFile edgeFile(m_gpioDirectory.path() + QDir::separator() + "edge");
-    if (!edgeFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "edge file:" << edgeFile.errorString();
-        return false;
+    GPIO_TRACE(GpioTrace::PointSetEdgeInterrupt, m_gpio, edge);
+    if (m_writeElision.loadAcquire() && m_edgeCached && m_edge == edge) {
+        m_elidedWrites++;
+        return true;
     }
 
-    QTextStream out(&edgeFile);
-    switch (edge) {
-    case EdgeFalling:
-        out << "falling";
-        break;
-    case EdgeRising:
-        out << "rising";
-        break;
-    case EdgeBoth:
-        out << "both";
-        break;
-    case EdgeNone:
-        out << "none";
-        break;
+    m_performedWrites++;
+    if (!m_backend->setEdgeInterrupt(edge)) {
+        m_errors++;
+        m_edgeCached = false;
+        return false;
     }
 
-    edgeFile.close();
+    m_edge = edge;
+    m_edgeCached = true;
     return true;
 }
 
-/*! Returns the edge interrupt of this Gpio. */
+/*! Returns the edge interrupt of this Gpio. The setting will be read from the kernel only if it is not cached yet.
+
+    \sa refresh()
+*/
 Gpio::Edge Gpio::edgeInterrupt()
 {
-    QFile edgeFile(m_gpioDirectory.path() + QDir::separator() + "edge");
-    if (!edgeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "edge file:" << edgeFile.errorString();
-        return Gpio::EdgeNone;
+    GpioConfigurationLocker locker(this);
+    if (!m_edgeCached) {
+        m_reads++;
+        m_edge = m_backend->edgeInterrupt();
+        m_edgeCached = true;
     }
 
-    QString edge;
-    QTextStream in(&edgeFile);
-    in >> edge;
-    edgeFile.close();
-
-    if (edge.contains("falling")) {
-        return Gpio::EdgeFalling;
-    } else if (edge.contains("rising")) {
-        return Gpio::EdgeRising;
-    } else if (edge.contains("both")) {
-        return Gpio::EdgeBoth;
-    } else if (edge.contains("none")) {
-        return Gpio::EdgeNone;
-    }
+    return m_edge;
+}
 
-    return Gpio::EdgeNone;
+/*! Returns true if the \tt value file of this Gpio will be kept open between \l{setValue()} and \l{value()} calls.
+
+    \sa setPersistentValueFile()
+*/
+bool Gpio::persistentValueFile() const
+{
+    return m_persistentValueFile;
 }
 
+/*! Enables or disables the persistent \tt value file access of this Gpio depending on \a persistentValueFile.
+    If enabled, the file will be opened on the first value access and kept open until the Gpio gets unexported.
+    If the persistent access fails, the file will be closed and the regular per call file access will be used.
+
+    \note This setting only affects the sysfs backend. The character device backend always accesses the values
+    through the line request.
+
+    \sa persistentValueFile()
+*/
+void Gpio::setPersistentValueFile(bool persistentValueFile)
+{
+    GpioConfigurationLocker locker(this);
+    m_persistentValueFile = persistentValueFile;
+    m_backend->setPersistentValueFile(m_persistentValueFile);
+}
+
+/*! Returns the time in milliseconds \l{exportGpio()} waits until a newly exported Gpio is accessible. The default is 1000 ms.
+
+    \sa setExportTimeout()
+*/
+int Gpio::exportTimeout() const
+{
+    return m_exportTimeout;
+}
+
+/*! Sets the time in milliseconds \l{exportGpio()} waits until a newly exported Gpio is accessible to \a exportTimeout.
+
+    Using the sysfs backend, the kernel creates the attribute files of an exported GPIO owned by root and udev adjusts
+    the permissions afterwards. Instead of returning immediately, \l{exportGpio()} waits using \tt inotify until the
+    \tt direction and \tt value files are writable and returns false if that did not happen within \a exportTimeout.
+    This makes fixed sleeps between exporting and configuring the Gpio unnecessary. A timeout of 0 only checks once.
+*/
+void Gpio::setExportTimeout(int exportTimeout)
+{
+    GpioConfigurationLocker locker(this);
+    m_exportTimeout = qMax(exportTimeout, 0);
+    m_backend->setExportTimeout(m_exportTimeout);
+}
+
+/*! Reads the configuration of this Gpio from the kernel and updates the cache. Returns false if the direction could not be read.
+
+    \sa invalidateCache()
+*/
+bool Gpio::refresh()
+{
+    GpioConfigurationLocker locker(this);
+    invalidateCache();
+    direction();
+    activeLow();
+    edgeInterrupt();
+    return m_direction.loadAcquire() != Gpio::DirectionInvalid;
+}
+
+/*! Discards the cached configuration of this Gpio. The next access of the configuration will read it from the kernel.
+
+    \sa refresh()
+*/
+void Gpio::invalidateCache()
+{
+    GpioConfigurationLocker locker(this);
+    m_direction.storeRelease(Gpio::DirectionInvalid);
+    m_activeLowCached = false;
+    m_edgeCached = false;
+    m_lastValue.storeRelease(Gpio::ValueInvalid);
+}
+
+/*! Returns true if writes which would not change the cached state of this Gpio will be skipped.
+
+    \sa setWriteElision()
+*/
+bool Gpio::writeElision() const
+{
+    return m_writeElision.loadAcquire() != 0;
+}
+
+/*! Enables or disables the write elision mode depending on \a writeElision. If enabled, \l{setValue()}, \l{setDirection()},
+    \l{setActiveLow()} and \l{setEdgeInterrupt()} compare the requested state against the cached state and return true
+    without accessing the kernel if nothing would change. The last written value will be remembered until the direction or
+    the active low setting changes.
+
+    \note Changes made from outside of this object will not be detected, use \l{invalidateCache()} if that might happen.
+    Also setting the direction of an output to output again does not reset the value to low if the write gets elided.
+
+    \sa elidedWrites(), performedWrites()
+*/
+void Gpio::setWriteElision(bool writeElision)
+{
+    m_writeElision.storeRelease(writeElision ? 1 : 0);
+}
+
+/*! Returns the number of writes which have been skipped by the write elision mode.
+
+    \sa setWriteElision(), resetWriteCounters()
+*/
+quint64 Gpio::elidedWrites() const
+{
+    return m_elidedWrites;
+}
+
+/*! Returns the number of writes which have been passed to the kernel.
+
+    \sa setWriteElision(), resetWriteCounters()
+*/
+quint64 Gpio::performedWrites() const
+{
+    return m_performedWrites;
+}
+
+/*! Resets the \l{elidedWrites()} and \l{performedWrites()} counters. */
+void Gpio::resetWriteCounters()
+{
+    m_elidedWrites = 0;
+    m_performedWrites = 0;
+}
+
+/*! Returns a snapshot of the access counters of this Gpio. The edge related fields are only used by the \l{GpioMonitor}.
+
+    \sa resetStatistics(), GpioMonitor::statistics()
+*/
+GpioStatistics Gpio::statistics() const
+{
+    GpioStatistics statistics;
+    statistics.gpio = m_gpio;
+    statistics.reads = m_reads;
+    statistics.writes = m_performedWrites;
+    statistics.elidedWrites = m_elidedWrites;
+    statistics.errors = m_errors;
+    return statistics;
+}
+
+/*! Resets all counters reported by \l{statistics()}, including the write counters.
+
+    \sa resetWriteCounters()
+*/
+void Gpio::resetStatistics()
+{
+    resetWriteCounters();
+    m_reads = 0;
+    m_errors = 0;
+}
 
 /*! Prints the given \a gpio to \a debug. */
 QDebug operator<<(QDebug debug, Gpio *gpio)
 {
     debug.nospace() << "Gpio(" << gpio->gpioNumber() << ", ";
-    if (gpio->direction() == Gpio::DirectionInput) {
+    Gpio::Direction direction = gpio->direction();
+    if (direction == Gpio::DirectionInput) {
         debug.nospace() << "input, ";
 
         switch (gpio->edgeInterrupt()) {
@@ -461,7 +750,7 @@ QDebug operator<<(QDebug debug, Gpio *gpio)
             debug.nospace() << "edge: none, ";
             break;
         }
-    } else if (gpio->direction() == Gpio::DirectionOutput) {
+    } else if (direction == Gpio::DirectionOutput) {
         debug.nospace() << "output, ";
     } else {
         debug.nospace() << "invalid, ";
@@ -473,9 +762,10 @@ QDebug operator<<(QDebug debug, Gpio *gpio)
         debug.nospace() << "active low: 0, ";
     }
 
-    if (gpio->value() == Gpio::ValueHigh) {
+    Gpio::Value value = gpio->value();
+    if (value == Gpio::ValueHigh) {
         debug.nospace() << "value: 1";
-    } else if (gpio->value() == Gpio::ValueLow) {
+    } else if (value == Gpio::ValueLow) {
         debug.nospace() << "value: 0";
     } else {
         debug.nospace() << "value: invalid";
@@ -32,12 +32,18 @@
 #define GPIO_H
 
 #include <QDir>
+#include <QMutex>
 #include <QDebug>
 #include <QObject>
+#include <QAtomicInteger>
 #include <QLoggingCategory>
 
+#include "gpiostatistics.h"
+
 Q_DECLARE_LOGGING_CATEGORY(dcGpio)
 
+class GpioBackend;
+
 class Gpio : public QObject
 {
     Q_OBJECT
@@ -65,11 +71,25 @@ public:
     };
     Q_ENUM(Edge)
 
+    enum Backend {
+        BackendAuto,
+        BackendSysfs,
+        BackendCharacterDevice,
+        BackendMock
+    };
+    Q_ENUM(Backend)
+
     explicit Gpio(int gpio, QObject *parent = nullptr);
+    Gpio(int gpio, Gpio::Backend backend, QObject *parent = nullptr);
+    explicit Gpio(const QString &lineName, QObject *parent = nullptr);
+    Gpio(const QString &lineName, Gpio::Backend backend, QObject *parent = nullptr);
     ~Gpio();
 
     static bool isAvailable();
 
+    Gpio::Backend backendType() const;
+    GpioBackend *backend() const;
+
     QString gpioDirectory() const;
     int gpioNumber() const;
 
@@ -88,11 +108,61 @@ public:
     bool setEdgeInterrupt(Gpio::Edge edge);
     Gpio::Edge edgeInterrupt();
 
+    bool persistentValueFile() const;
+    void setPersistentValueFile(bool persistentValueFile);
+
+    int exportTimeout() const;
+    void setExportTimeout(int exportTimeout);
+
+    bool refresh();
+    void invalidateCache();
+
+    bool writeElision() const;
+    void setWriteElision(bool writeElision);
+
+    quint64 elidedWrites() const;
+    quint64 performedWrites() const;
+    void resetWriteCounters();
+
+    GpioStatistics statistics() const;
+    void resetStatistics();
+
 private:
+    friend class GpioValueAccess;
+    friend class GpioConfigurationLocker;
+
     int m_gpio = 0;
-    Gpio::Direction m_direction = Gpio::DirectionOutput;
     QDir m_gpioDirectory;
 
+    // Serializes the configuration, value accesses only wait while a configuration change is in progress
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    QRecursiveMutex m_configurationMutex;
+#else
+    QMutex m_configurationMutex;
+#endif
+    int m_configurationDepth = 0;
+    QAtomicInt m_configuring;
+    QAtomicInt m_valueAccesses;
+
+    // Cached configuration, only valid if known. The direction and the last value are read by the value accesses.
+    QAtomicInt m_direction;
+    bool m_activeLow = false;
+    bool m_activeLowCached = false;
+    Gpio::Edge m_edge = Gpio::EdgeNone;
+    bool m_edgeCached = false;
+    QAtomicInt m_lastValue;
+
+    QAtomicInt m_writeElision;
+    QAtomicInteger<quint64> m_elidedWrites;
+    QAtomicInteger<quint64> m_performedWrites;
+    QAtomicInteger<quint64> m_reads;
+    QAtomicInteger<quint64> m_errors;
+
+    Gpio::Backend m_requestedBackend = Gpio::BackendAuto;
+    GpioBackend *m_backend = nullptr;
+    bool m_persistentValueFile = false;
+    int m_exportTimeout = 1000;
+
 };
 
 QDebug operator<< (QDebug debug, Gpio *gpio);
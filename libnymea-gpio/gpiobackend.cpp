@@ -0,0 +1,174 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioBackend
+    \brief The interface between the Gpio API and the kernel GPIO interface.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The GpioBackend performs the actual I/O for a \l{Gpio}. Currently there are three implementations:
+
+    \list
+        \li The \b sysfs backend using the legacy \tt {/sys/class/gpio} interface.
+        \li The \b {character device} backend using the \tt {/dev/gpiochipN} line requests of the GPIO v2 uAPI.
+        \li The \b mock backend simulating the GPIOs in memory, see \l{GpioMockBackend}.
+    \endlist
+
+    The backend will be selected at runtime. If a GPIO character device is available, the character device backend
+    will be used, otherwise the sysfs interface. The selection can be forced by setting the environment variable
+    \tt NYMEA_GPIO_BACKEND to \tt sysfs, \tt chardev or \tt mock.
+
+    \sa Gpio::backend()
+*/
+
+/*!
+    \class GpioEvent
+    \brief Describes one interrupt event of a GPIO.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The \c value is the logical value of the GPIO after the edge, the \c timestamp is given in nanoseconds of
+    \tt CLOCK_MONOTONIC and the \c sequence is the event sequence number reported by the kernel, or 0 if the
+    backend does not provide one.
+*/
+
+/*!
+    \fn Gpio::Backend GpioBackend::type() const
+    Returns the type of this backend.
+*/
+
+/*!
+    \fn int GpioBackend::eventFd()
+    Returns the file descriptor which signals GPIO interrupts, or -1 if the interrupt could not be set up.
+    The returned descriptor will be owned by the backend.
+
+    \sa eventNotifierType(), readEvents()
+*/
+
+/*!
+    \fn QSocketNotifier::Type GpioBackend::eventNotifierType() const
+    Returns the QSocketNotifier type which indicates events on the \l{eventFd()}.
+*/
+
+/*!
+    \fn int GpioBackend::readEvents(GpioEvent *events, int maxEvents)
+    Reads at most \a maxEvents pending interrupt events into \a events. Returns the number of events read, or -1 on error.
+*/
+
+#include "gpiobackend.h"
+#include "gpiosysfsbackend.h"
+#include "gpiochardevbackend.h"
+#include "gpiomockbackend.h"
+
+/*! Constructs the backend for the given \a gpio number. */
+GpioBackend::GpioBackend(int gpio) :
+    m_gpio(gpio)
+{
+
+}
+
+/*! Creates a new backend of the given \a backend type for the given \a gpio number. If \a backend is \l{Gpio::BackendAuto},
+    the backend will be selected using \l{availableBackend()}. The caller takes ownership of the returned object. */
+GpioBackend *GpioBackend::create(int gpio, Gpio::Backend backend)
+{
+    if (backend == Gpio::BackendAuto)
+        backend = availableBackend();
+
+    switch (backend) {
+    case Gpio::BackendCharacterDevice:
+        return new GpioChardevBackend(gpio);
+    case Gpio::BackendMock:
+        return new GpioMockBackend(gpio);
+    default:
+        return new GpioSysfsBackend(gpio);
+    }
+}
+
+/*! Returns the backend which will be used for \l{Gpio::BackendAuto} on this system. */
+Gpio::Backend GpioBackend::availableBackend()
+{
+    QByteArray requestedBackend = qgetenv("NYMEA_GPIO_BACKEND").toLower();
+    if (requestedBackend == "sysfs") {
+        return Gpio::BackendSysfs;
+    } else if (requestedBackend == "chardev") {
+        return Gpio::BackendCharacterDevice;
+    } else if (requestedBackend == "mock") {
+        return Gpio::BackendMock;
+    }
+
+    if (GpioChardevBackend::isAvailable())
+        return Gpio::BackendCharacterDevice;
+
+    return Gpio::BackendSysfs;
+}
+
+/*! Returns true if the kernel queues the interrupt events of this backend, so \l{readEvents()} can be called again until all
+    pending events have been read. Backends which read the current value instead return false, since every read would return
+    another event. The default implementation returns true. */
+bool GpioBackend::queuesEvents() const
+{
+    return true;
+}
+
+/*! Returns the gpio number of this backend. */
+int GpioBackend::gpioNumber() const
+{
+    return m_gpio;
+}
+
+/*! Enables or disables keeping the value file open between value accesses depending on \a persistentValueFile.
+    The default implementation does nothing, since not all backends access files per call. */
+void GpioBackend::setPersistentValueFile(bool persistentValueFile)
+{
+    Q_UNUSED(persistentValueFile)
+}
+
+/*! Sets the number of interrupt events the kernel should buffer to \a eventBufferSize. This has to be set before the GPIO
+    gets exported. The default implementation does nothing, since not all backends queue events. */
+void GpioBackend::setEventBufferSize(int eventBufferSize)
+{
+    Q_UNUSED(eventBufferSize)
+}
+
+/*! Sets the time in milliseconds \l{exportGpio()} waits until an exported GPIO is accessible to \a exportTimeout.
+    The default implementation does nothing, since not all backends have to wait for the export. */
+void GpioBackend::setExportTimeout(int exportTimeout)
+{
+    Q_UNUSED(exportTimeout)
+}
+
+/*! Requests the kernel to debounce the input with the given \a debouncePeriod in microseconds. A period of 0 disables the
+    debouncing. Returns false if the backend does not support debouncing, which is the default implementation. */
+bool GpioBackend::setDebounce(int debouncePeriod)
+{
+    Q_UNUSED(debouncePeriod)
+    return false;
+}
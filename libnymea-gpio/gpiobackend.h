@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOBACKEND_H
+#define GPIOBACKEND_H
+
+#include <QString>
+#include <QSocketNotifier>
+
+#include "gpio.h"
+
+struct GpioEvent
+{
+    bool value = false;
+    qint64 timestamp = 0;
+    quint32 sequence = 0;
+};
+
+class GpioBackend
+{
+public:
+    explicit GpioBackend(int gpio);
+    virtual ~GpioBackend() = default;
+
+    static GpioBackend *create(int gpio, Gpio::Backend backend = Gpio::BackendAuto);
+    static Gpio::Backend availableBackend();
+
+    int gpioNumber() const;
+
+    virtual Gpio::Backend type() const = 0;
+
+    virtual bool exportGpio() = 0;
+    virtual bool unexportGpio() = 0;
+
+    virtual bool setDirection(Gpio::Direction direction) = 0;
+    virtual Gpio::Direction direction() = 0;
+
+    virtual bool setValue(Gpio::Value value) = 0;
+    virtual Gpio::Value value() = 0;
+
+    virtual bool setActiveLow(bool activeLow) = 0;
+    virtual bool activeLow() = 0;
+
+    virtual bool setEdgeInterrupt(Gpio::Edge edge) = 0;
+    virtual Gpio::Edge edgeInterrupt() = 0;
+
+    virtual void setPersistentValueFile(bool persistentValueFile);
+    virtual void setEventBufferSize(int eventBufferSize);
+    virtual void setExportTimeout(int exportTimeout);
+    virtual bool setDebounce(int debouncePeriod);
+
+    // Interrupt interface used by the monitors
+    virtual int eventFd() = 0;
+    virtual QSocketNotifier::Type eventNotifierType() const = 0;
+    virtual int readEvents(GpioEvent *events, int maxEvents) = 0;
+    virtual bool queuesEvents() const;
+
+protected:
+    int m_gpio = 0;
+
+};
+
+#endif // GPIOBACKEND_H
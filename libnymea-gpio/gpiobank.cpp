@@ -0,0 +1,441 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioBank
+    \brief Allows to read and write multiple GPIOs with one call.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    A GpioBank groups up to 64 GPIOs. The bit \c n of the masks and values used by \l{setValues()} and \l{values()} corresponds
+    to the GPIO at index \c n of the list passed to the constructor.
+
+    Using the character device backend, all lines of the bank belonging to the same chip will be requested with one line request.
+    Updating the whole bank costs one \tt ioctl per chip and all outputs of a chip change at the same moment. Using the sysfs backend,
+    the bank keeps the \tt value files of all GPIOs open and writes them one after the other.
+
+    \code
+        GpioBank *bank = new GpioBank({5, 6, 13, 19, 26}, this);
+        if (!bank->exportGpios() || !bank->setDirection(Gpio::DirectionOutput)) {
+            qWarning() << "Could not set up the GPIO bank";
+            bank->deleteLater();
+            return;
+        }
+
+        // Set GPIO 5 and 13 high, GPIO 6 low, leave the others untouched
+        bank->setValues(0x07, 0x05);
+    \endcode
+
+    \sa Gpio
+*/
+
+#include "gpiobank.h"
+#include "gpiosysfsbackend.h"
+#include "gpiochardevbackend.h"
+#include "gpiochipinfo.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+static const char *bankConsumer = "nymea-gpio";
+
+static quint64 linesMask(int count)
+{
+    return count >= 64 ? ~static_cast<quint64>(0) : ((static_cast<quint64>(1) << count) - 1);
+}
+
+/*! Constructs a GpioBank for the given \a gpios numbers with the given \a parent. The backend will be selected automatically. */
+GpioBank::GpioBank(const QList<int> &gpios, QObject *parent) :
+    GpioBank(gpios, Gpio::BackendAuto, parent)
+{
+
+}
+
+/*! Constructs a GpioBank for the given \a gpios numbers with the given \a parent using the given \a backend. */
+GpioBank::GpioBank(const QList<int> &gpios, Gpio::Backend backend, QObject *parent) :
+    QObject(parent),
+    m_gpios(gpios),
+    m_requestedBackend(backend)
+{
+    if (m_gpios.count() > 64) {
+        qCWarning(dcGpio()) << "GpioBank: A bank can contain at most 64 GPIOs. Ignoring" << m_gpios.count() - 64 << "GPIOs.";
+        m_gpios = m_gpios.mid(0, 64);
+    }
+
+    m_backend = (m_requestedBackend == Gpio::BackendAuto ? GpioBackend::availableBackend() : m_requestedBackend);
+}
+
+/*! Destroys and unexports the GpioBank. */
+GpioBank::~GpioBank()
+{
+    unexportGpios();
+}
+
+/*! Returns the GPIO numbers of this bank. */
+QList<int> GpioBank::gpios() const
+{
+    return m_gpios;
+}
+
+/*! Returns the number of GPIOs in this bank. */
+int GpioBank::count() const
+{
+    return m_gpios.count();
+}
+
+/*! Returns the type of the backend used by this bank. */
+Gpio::Backend GpioBank::backendType() const
+{
+    return m_backend;
+}
+
+/*! Returns true if all GPIOs of this bank could be exported. Using the character device backend, the lines of each chip
+    will be requested with their current configuration. If the automatically selected character device backend could not
+    request the lines, the bank falls back to the sysfs backend.
+*/
+bool GpioBank::exportGpios()
+{
+    qCDebug(dcGpio()) << "GpioBank: Export GPIOs" << m_gpios;
+    unexportGpios();
+
+    if (m_backend == Gpio::BackendCharacterDevice) {
+        if (exportCharacterDevice())
+            return true;
+
+        releaseLines();
+        if (m_requestedBackend != Gpio::BackendAuto || !GpioSysfsBackend::isAvailable())
+            return false;
+
+        qCDebug(dcGpio()) << "GpioBank: Falling back to the sysfs backend.";
+        m_backend = Gpio::BackendSysfs;
+    }
+
+    return exportSysfs();
+}
+
+/*! Returns true if all GPIOs of this bank could be unexported or the line requests could be released. */
+bool GpioBank::unexportGpios()
+{
+    releaseLines();
+
+    bool success = true;
+    foreach (GpioBackend *backend, m_sysfsBackends) {
+        if (!backend->unexportGpio())
+            success = false;
+
+        delete backend;
+    }
+    m_sysfsBackends.clear();
+    return success;
+}
+
+/*! Returns true if the \a direction of all GPIOs of this bank could be set. Changing to output drives all lines low. */
+bool GpioBank::setDirection(Gpio::Direction direction)
+{
+    if (direction == Gpio::DirectionInvalid) {
+        qCWarning(dcGpio()) << "GpioBank: Setting an invalid direction is forbidden.";
+        return false;
+    }
+
+    if (m_backend == Gpio::BackendCharacterDevice) {
+        bool success = true;
+        for (int i = 0; i < m_requests.count(); i++) {
+            LineRequest &request = m_requests[i];
+            quint64 flags = request.flags & ~static_cast<quint64>(GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_OUTPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING);
+            flags |= (direction == Gpio::DirectionOutput ? GPIO_V2_LINE_FLAG_OUTPUT : GPIO_V2_LINE_FLAG_INPUT);
+            request.outputBits = 0;
+            if (!configureLines(request, flags))
+                success = false;
+        }
+        return success && !m_requests.isEmpty();
+    }
+
+    bool success = true;
+    foreach (GpioBackend *backend, m_sysfsBackends) {
+        if (!backend->setDirection(direction))
+            success = false;
+    }
+    return success && !m_sysfsBackends.isEmpty();
+}
+
+/*! Returns true if the logic of all GPIOs in this bank could be set to \a activeLow. */
+bool GpioBank::setActiveLow(bool activeLow)
+{
+    if (m_backend == Gpio::BackendCharacterDevice) {
+        bool success = true;
+        for (int i = 0; i < m_requests.count(); i++) {
+            LineRequest &request = m_requests[i];
+            quint64 flags = request.flags;
+            if (activeLow) {
+                flags |= GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+            } else {
+                flags &= ~static_cast<quint64>(GPIO_V2_LINE_FLAG_ACTIVE_LOW);
+            }
+            if (!configureLines(request, flags))
+                success = false;
+        }
+        return success && !m_requests.isEmpty();
+    }
+
+    bool success = true;
+    foreach (GpioBackend *backend, m_sysfsBackends) {
+        if (!backend->setActiveLow(activeLow))
+            success = false;
+    }
+    return success && !m_sysfsBackends.isEmpty();
+}
+
+/*! Sets the GPIOs selected by \a mask to the corresponding values in \a bits. GPIOs not selected by \a mask keep their value.
+    Returns true if all selected values could be set.
+*/
+bool GpioBank::setValues(quint64 mask, quint64 bits)
+{
+    mask &= linesMask(m_gpios.count());
+
+    if (m_backend == Gpio::BackendCharacterDevice) {
+        bool success = true;
+        for (int i = 0; i < m_requests.count(); i++) {
+            LineRequest &request = m_requests[i];
+            struct gpio_v2_line_values values;
+            memset(&values, 0, sizeof(values));
+            for (int line = 0; line < request.bankIndices.count(); line++) {
+                quint64 bankBit = static_cast<quint64>(1) << request.bankIndices.at(line);
+                if (!(mask & bankBit))
+                    continue;
+
+                values.mask |= static_cast<quint64>(1) << line;
+                if (bits & bankBit) {
+                    values.bits |= static_cast<quint64>(1) << line;
+                }
+            }
+
+            if (values.mask == 0)
+                continue;
+
+            if (ioctl(request.requestFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+                qCWarning(dcGpio()) << "GpioBank: Could not set values on" << request.chipPath << ":" << strerror(errno);
+                success = false;
+                continue;
+            }
+
+            request.outputBits = (request.outputBits & ~values.mask) | values.bits;
+        }
+        return success;
+    }
+
+    bool success = true;
+    for (int i = 0; i < m_sysfsBackends.count(); i++) {
+        quint64 bankBit = static_cast<quint64>(1) << i;
+        if (!(mask & bankBit))
+            continue;
+
+        if (!m_sysfsBackends.at(i)->setValue((bits & bankBit) ? Gpio::ValueHigh : Gpio::ValueLow))
+            success = false;
+    }
+    return success;
+}
+
+/*! Returns the values of all GPIOs in this bank. If \a ok is not null, it will be set to false if any value could not be read. */
+quint64 GpioBank::values(bool *ok)
+{
+    bool success = true;
+    quint64 bits = 0;
+
+    if (m_backend == Gpio::BackendCharacterDevice) {
+        for (int i = 0; i < m_requests.count(); i++) {
+            const LineRequest &request = m_requests.at(i);
+            struct gpio_v2_line_values values;
+            memset(&values, 0, sizeof(values));
+            values.mask = linesMask(request.offsets.count());
+            if (ioctl(request.requestFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+                qCWarning(dcGpio()) << "GpioBank: Could not get values from" << request.chipPath << ":" << strerror(errno);
+                success = false;
+                continue;
+            }
+
+            for (int line = 0; line < request.bankIndices.count(); line++) {
+                if (values.bits & (static_cast<quint64>(1) << line)) {
+                    bits |= static_cast<quint64>(1) << request.bankIndices.at(line);
+                }
+            }
+        }
+    } else {
+        for (int i = 0; i < m_sysfsBackends.count(); i++) {
+            Gpio::Value value = m_sysfsBackends.at(i)->value();
+            if (value == Gpio::ValueInvalid) {
+                success = false;
+            } else if (value == Gpio::ValueHigh) {
+                bits |= static_cast<quint64>(1) << i;
+            }
+        }
+    }
+
+    if (ok)
+        *ok = success && count() > 0;
+
+    return bits;
+}
+
+bool GpioBank::exportCharacterDevice()
+{
+    for (int i = 0; i < m_gpios.count(); i++) {
+        QString chipPath;
+        unsigned int offset = 0;
+        if (!GpioChipInfo::resolveLine(m_gpios.at(i), &chipPath, &offset)) {
+            qCWarning(dcGpio()) << "GpioBank: Could not find a GPIO chip providing GPIO" << m_gpios.at(i);
+            return false;
+        }
+
+        int requestIndex = -1;
+        for (int j = 0; j < m_requests.count(); j++) {
+            if (m_requests.at(j).chipPath == chipPath) {
+                requestIndex = j;
+                break;
+            }
+        }
+
+        if (requestIndex < 0) {
+            LineRequest request;
+            request.chipPath = chipPath;
+            m_requests.append(request);
+            requestIndex = m_requests.count() - 1;
+        }
+
+        m_requests[requestIndex].offsets.append(offset);
+        m_requests[requestIndex].bankIndices.append(i);
+    }
+
+    for (int i = 0; i < m_requests.count(); i++) {
+        LineRequest &request = m_requests[i];
+        request.chipFd = ::open(request.chipPath.toLocal8Bit().constData(), O_RDWR | O_CLOEXEC);
+        if (request.chipFd < 0) {
+            qCWarning(dcGpio()) << "GpioBank: Could not open GPIO chip" << request.chipPath << ":" << strerror(errno);
+            return false;
+        }
+
+        if (!requestLines(request))
+            return false;
+    }
+
+    return true;
+}
+
+bool GpioBank::exportSysfs()
+{
+    bool success = true;
+    foreach (int gpio, m_gpios) {
+        // One backend per GPIO, which also serves the mock backend
+        GpioBackend *backend = GpioBackend::create(gpio, m_backend);
+        backend->setPersistentValueFile(true);
+        m_sysfsBackends.append(backend);
+        if (!backend->exportGpio())
+            success = false;
+    }
+
+    return success;
+}
+
+bool GpioBank::requestLines(LineRequest &request)
+{
+    struct gpio_v2_line_request lineRequest;
+    memset(&lineRequest, 0, sizeof(lineRequest));
+    for (int line = 0; line < request.offsets.count(); line++) {
+        lineRequest.offsets[line] = request.offsets.at(line);
+    }
+    lineRequest.num_lines = static_cast<__u32>(request.offsets.count());
+    strncpy(lineRequest.consumer, bankConsumer, sizeof(lineRequest.consumer) - 1);
+    lineRequest.config.flags = request.flags;
+    if (request.flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+        lineRequest.config.num_attrs = 1;
+        lineRequest.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        lineRequest.config.attrs[0].attr.values = request.outputBits;
+        lineRequest.config.attrs[0].mask = linesMask(request.offsets.count());
+    }
+
+    if (ioctl(request.chipFd, GPIO_V2_GET_LINE_IOCTL, &lineRequest) < 0) {
+        qCWarning(dcGpio()) << "GpioBank: Could not request" << request.offsets.count() << "lines of" << request.chipPath << ":" << strerror(errno);
+        return false;
+    }
+
+    request.requestFd = lineRequest.fd;
+    return true;
+}
+
+bool GpioBank::configureLines(LineRequest &request, quint64 flags)
+{
+    if (request.requestFd < 0)
+        return false;
+
+    struct gpio_v2_line_config config;
+    memset(&config, 0, sizeof(config));
+    config.flags = flags;
+    if (flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+        config.num_attrs = 1;
+        config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        config.attrs[0].attr.values = request.outputBits;
+        config.attrs[0].mask = linesMask(request.offsets.count());
+    }
+
+    if (ioctl(request.requestFd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) >= 0) {
+        request.flags = flags;
+        return true;
+    }
+
+    // Not every kernel supports changing every flag on an existing request, request the lines again
+    qCDebug(dcGpio()) << "GpioBank: Could not reconfigure lines of" << request.chipPath << ":" << strerror(errno) << "Requesting the lines again.";
+    quint64 previousFlags = request.flags;
+    ::close(request.requestFd);
+    request.requestFd = -1;
+
+    request.flags = flags;
+    if (requestLines(request))
+        return true;
+
+    request.flags = previousFlags;
+    requestLines(request);
+    return false;
+}
+
+void GpioBank::releaseLines()
+{
+    for (int i = 0; i < m_requests.count(); i++) {
+        LineRequest &request = m_requests[i];
+        if (request.requestFd >= 0)
+            ::close(request.requestFd);
+
+        if (request.chipFd >= 0)
+            ::close(request.chipFd);
+    }
+    m_requests.clear();
+}
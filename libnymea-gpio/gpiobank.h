@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOBANK_H
+#define GPIOBANK_H
+
+#include <QObject>
+#include <QVector>
+
+#include "gpio.h"
+
+class GpioBackend;
+
+class GpioBank : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioBank(const QList<int> &gpios, QObject *parent = nullptr);
+    GpioBank(const QList<int> &gpios, Gpio::Backend backend, QObject *parent = nullptr);
+    ~GpioBank();
+
+    QList<int> gpios() const;
+    int count() const;
+
+    Gpio::Backend backendType() const;
+
+    bool exportGpios();
+    bool unexportGpios();
+
+    bool setDirection(Gpio::Direction direction);
+    bool setActiveLow(bool activeLow);
+
+    bool setValues(quint64 mask, quint64 bits);
+    quint64 values(bool *ok = nullptr);
+
+private:
+    struct LineRequest {
+        QString chipPath;
+        int chipFd = -1;
+        int requestFd = -1;
+        QVector<unsigned int> offsets;
+        QVector<int> bankIndices;
+        quint64 flags = 0;
+        quint64 outputBits = 0;
+    };
+
+    QList<int> m_gpios;
+    Gpio::Backend m_requestedBackend = Gpio::BackendAuto;
+    Gpio::Backend m_backend = Gpio::BackendSysfs;
+
+    QVector<LineRequest> m_requests;
+    QVector<GpioBackend *> m_sysfsBackends;
+
+    bool exportCharacterDevice();
+    bool exportSysfs();
+    bool requestLines(LineRequest &request);
+    bool configureLines(LineRequest &request, quint64 flags);
+    void releaseLines();
+
+};
+
+#endif // GPIOBANK_H
@@ -37,6 +37,37 @@
     This class represents a Button based on a GPIO. The class takes care about the \l{clicked()} signal handling, debounces the GPIO signal
     and offers a nice interface for \l{longPressed()} behaviour.
 
+    The button gets debounced by the kernel if the GPIO supports it, otherwise by the \l{GpioMonitor}
+    (\l{GpioMonitor::setDebounceInterval()}). Either way, bouncing edges never reach the button.
+
+    By default each button uses its own timer to detect long presses. Many buttons can share one \l{GpioTimerScheduler}
+    instead (\l{setTimerScheduler()}), which costs one timer and one wakeup for all of them.
+
+    \chapter Gestures
+    Besides the basic signals, the button recognizes gestures and reports each of them with one \l{gesture()} signal. The state
+    machine uses the edge timestamps and the timer of the button, it does not need any additional timers or
+    allocations per edge:
+
+    \list
+        \li A press shorter than the \l{clickTimeout()} counts as a click.
+        \li Clicks following each other within the \l{multiPressInterval()} form one gesture of up to \l{maxPressCount()}
+            presses: a click, a double click or a multi press. The gesture will be reported once the interval passed
+            without another press, or immediately once the maximal number of presses has been reached.
+        \li A press longer than the \l{clickTimeout()} will be reported as hold release when the button gets released.
+    \endlist
+
+    By default \l{maxPressCount()} is 1, which reports each click immediately. Allowing double clicks delays the report of a
+    single click by the \l{multiPressInterval()}.
+
+    \code
+        GpioButton *button = new GpioButton(15, this);
+        button->setMaxPressCount(3);
+        connect(button, &GpioButton::gesture, this, [](GpioButton::Gesture gesture, int pressCount, int duration){
+            qDebug() << "Gesture" << gesture << pressCount << "presses, last press took" << duration << "ms";
+        });
+        button->enable();
+    \endcode
+
     In order to get the button signals, the button has to be enabled using \l{enable()}.
 
     \code
@@ -56,9 +87,30 @@
 
 */
 
+/*!
+    \enum GpioButton::Gesture
+    This enum type specifies the gesture reported by \l{gesture()}.
+
+    \value GestureClick
+        The button has been clicked once.
+    \value GestureDoubleClick
+        The button has been clicked twice within the \l{multiPressInterval()}.
+    \value GestureMultiPress
+        The button has been clicked more than twice within the \l{multiPressInterval()}.
+    \value GestureHoldRelease
+        The button has been released after being pressed longer than the \l{clickTimeout()}.
+*/
+
+/*!
+    \fn void GpioButton::gesture(GpioButton::Gesture gesture, int pressCount, int duration);
+    This signal will be emitted once a \a gesture has been recognized. The \a pressCount is the number of clicks of the gesture
+    and the \a duration is the duration of the last press in milliseconds.
+*/
+
 /*!
     \fn void GpioButton::clicked();
-    This signal will be emitted when the button gets clicked. A button will has been clicked, if it was pressed at leased for 10 ms and at most 500 ms.
+    This signal will be emitted when the button gets clicked. A button will has been clicked, if it was pressed at most for the \l{clickTimeout()}.
+    This signal will be emitted for each click, independent of the \l{gesture()} recognition.
 */
 
 /*!
@@ -80,6 +132,9 @@
 
 #include "gpiobutton.h"
 #include "gpiomonitor.h"
+#include "gpiochipinfo.h"
+#include "gpiotimerscheduler.h"
+#include "gpiorealtime.h"
 
 /*! Constructs a \l{GpioButton} object with the given \a gpio number and \a parent. */
 GpioButton::GpioButton(int gpio, QObject *parent) :
@@ -89,6 +144,22 @@ GpioButton::GpioButton(int gpio, QObject *parent) :
 
 }
 
+/*! Constructs a \l{GpioButton} object for the GPIO line with the given \a lineName and \a parent.
+
+    \sa GpioChipInfo::gpioNumber()
+*/
+GpioButton::GpioButton(const QString &lineName, QObject *parent) :
+    GpioButton(GpioChipInfo::gpioNumber(lineName), parent)
+{
+
+}
+
+/*! Destroys this GpioButton and unexports the Gpio. */
+GpioButton::~GpioButton()
+{
+    disable();
+}
+
 /*! Returns the gpio number for this GpioButton. */
 int GpioButton::gpioNumber() const
 {
@@ -146,6 +217,86 @@ void GpioButton::setLongPressedTimeout(int longPressedTimeout)
     m_longPressedTimeout = longPressedTimeout;
 }
 
+/*! Returns the debounce interval in milliseconds. The default is 10 ms.
+
+  \sa GpioMonitor::debounceInterval()
+*/
+int GpioButton::debounceInterval() const
+{
+    return m_debounceInterval;
+}
+
+/*! Sets the debounce interval to \a debounceInterval in milliseconds. Edges following a press or release within this interval
+    will be ignored. A value of 0 disables the debouncing. This has to be set before the button gets enabled.
+
+  \sa GpioMonitor::setDebounceInterval()
+*/
+void GpioButton::setDebounceInterval(int debounceInterval)
+{
+    m_debounceInterval = qMax(debounceInterval, 0);
+}
+
+/*! Returns the maximal duration of a click in milliseconds. The default is 500 ms.
+
+  \sa clicked(), gesture()
+*/
+int GpioButton::clickTimeout() const
+{
+    return m_clickTimeout;
+}
+
+/*! Sets the maximal duration of a click to \a clickTimeout in milliseconds. Longer presses will be reported as
+    \l{GestureHoldRelease}{hold release}. */
+void GpioButton::setClickTimeout(int clickTimeout)
+{
+    m_clickTimeout = qMax(clickTimeout, 0);
+}
+
+/*! Returns the maximal time in milliseconds between releasing the button and the next press of the same gesture. The default is 250 ms. */
+int GpioButton::multiPressInterval() const
+{
+    return m_multiPressInterval;
+}
+
+/*! Sets the maximal time between releasing the button and the next press of the same gesture to \a multiPressInterval milliseconds. */
+void GpioButton::setMultiPressInterval(int multiPressInterval)
+{
+    m_multiPressInterval = qMax(multiPressInterval, 0);
+}
+
+/*! Returns the maximal number of presses forming one gesture. The default is 1, which reports every click immediately. */
+int GpioButton::maxPressCount() const
+{
+    return m_maxPressCount;
+}
+
+/*! Sets the maximal number of presses forming one gesture to \a maxPressCount. A value of 2 enables double clicks, higher
+    values enable multi presses. The gesture will be reported as soon as this number of presses has been reached. */
+void GpioButton::setMaxPressCount(int maxPressCount)
+{
+    m_maxPressCount = qMax(maxPressCount, 1);
+}
+
+/*! Returns the shared timer scheduler used for the long press detection, or \c nullptr if the button uses its own timer.
+
+  \sa setTimerScheduler()
+*/
+GpioTimerScheduler *GpioButton::timerScheduler() const
+{
+    return m_timerScheduler.data();
+}
+
+/*! Uses the shared \a timerScheduler for the long press detection instead of a timer per button. The scheduler has to live in
+    the thread of this button. Passing \c nullptr makes the button use its own timer again. This has to be set before the button
+    gets enabled.
+
+  \sa GpioTimerScheduler
+*/
+void GpioButton::setTimerScheduler(GpioTimerScheduler *timerScheduler)
+{
+    m_timerScheduler = timerScheduler;
+}
+
 /*! Returns the \c name for this GpioButton. This is optional, but will be printed in the debug operator. */
 QString GpioButton::name() const
 {
@@ -158,35 +309,109 @@ void GpioButton::setName(const QString &name)
     m_name = name;
 }
 
+void GpioButton::startButtonTimer(int interval, bool repeating)
+{
+    if (m_schedulerTimerId >= 0 && m_timerScheduler) {
+        m_timerScheduler->start(m_schedulerTimerId, interval, repeating);
+    } else if (m_timer) {
+        m_timer->setSingleShot(!repeating);
+        m_timer->start(interval);
+    }
+}
+
+void GpioButton::stopButtonTimer()
+{
+    if (m_schedulerTimerId >= 0 && m_timerScheduler) {
+        m_timerScheduler->stop(m_schedulerTimerId);
+    } else if (m_timer) {
+        m_timer->stop();
+    }
+}
+
+void GpioButton::onSchedulerTimeout(void *context)
+{
+    static_cast<GpioButton *>(context)->onTimeout();
+}
+
+void GpioButton::finishGesture()
+{
+    int pressCount = m_pressCount;
+    m_pressCount = 0;
+    if (pressCount == 0)
+        return;
+
+    GpioButton::Gesture recognized = GestureMultiPress;
+    if (pressCount == 1) {
+        recognized = GestureClick;
+    } else if (pressCount == 2) {
+        recognized = GestureDoubleClick;
+    }
+
+    qCDebug(dcGpio()) << this << "gesture" << recognized << pressCount;
+    emit gesture(recognized, pressCount, m_lastPressDuration);
+}
+
 void GpioButton::onTimeout()
 {
+    // While released, the timer waits for the next press of a gesture
+    if (!m_pressed) {
+        finishGesture();
+        return;
+    }
+
     qCDebug(dcGpio()) << this << "long pressed";
     emit longPressed();
 }
 
-void GpioButton::onValueChanged(bool value)
+void GpioButton::onEdgeEvent(bool value, qint64 timestamp)
 {
+    // The edges of a debounced input alternate, ignore a release without a press
+    if (value == m_pressed)
+        return;
+
+    m_pressed = value;
     if (value) {
         // Pressed
         qCDebug(dcGpio()) << this << "pressed";
         emit pressed();
 
-        m_timer->setSingleShot(!m_repeateLongPressed);
-        m_timer->start(m_longPressedTimeout);
-        m_time.restart();
+        // The timer of the previous gesture might not have been delivered yet
+        if (m_pressCount > 0 && (timestamp - m_releasedTimestamp) / 1000000 > m_multiPressInterval)
+            finishGesture();
+
+        m_pressedTimestamp = timestamp;
+        startButtonTimer(m_longPressedTimeout, m_repeateLongPressed);
     } else {
         // Released
         qCDebug(dcGpio()) << this << "released";
         emit released();
 
-        m_timer->stop();
-        int duration = m_time.elapsed();
+        stopButtonTimer();
+        m_releasedTimestamp = timestamp;
 
-        // Debounce and limit to 500 ms
-        if (duration >= 10 && duration <= 500) {
-            qCDebug(dcGpio()) << this << "clicked";
-            emit clicked();
+        // Use the edge timestamps, the event loop might have delivered the events late
+        int duration = static_cast<int>((timestamp - m_pressedTimestamp) / 1000000);
+        if (duration > m_clickTimeout) {
+            finishGesture();
+            qCDebug(dcGpio()) << this << "gesture" << GestureHoldRelease << duration << "ms";
+            emit gesture(GestureHoldRelease, 1, duration);
+            return;
+        }
+
+        // The monitor debounced the edges already
+        qCDebug(dcGpio()) << this << "clicked";
+        emit clicked();
+
+        m_pressCount++;
+        m_lastPressDuration = duration;
+        if (m_pressCount >= m_maxPressCount) {
+            finishGesture();
+            return;
         }
+
+        // Wait for the next press, measured from the release edge
+        qint64 elapsed = (GpioRealtime::monotonicTime() - timestamp) / 1000000;
+        startButtonTimer(static_cast<int>(qMax<qint64>(m_multiPressInterval - elapsed, 0)), false);
     }
 }
 
@@ -195,8 +420,11 @@ bool GpioButton::enable()
 {
     // Make sure we have a clean start
     disable();
+    m_pressed = false;
+    m_pressCount = 0;
 
     m_monitor = new GpioMonitor(m_gpioNumber, this);
+    m_monitor->setDebounceInterval(m_debounceInterval);
 
     if (!m_monitor->enable(m_activeLow, Gpio::EdgeBoth)) {
         qCWarning(dcGpio()) << "Could not enable GPIO monitor for" << this;
@@ -204,9 +432,16 @@ bool GpioButton::enable()
         m_monitor = nullptr;
         return false;
     }
-    connect(m_monitor, &GpioMonitor::valueChanged, this, &GpioButton::onValueChanged);
+    m_monitor->subscribe([this](const GpioEvent &event) {
+        onEdgeEvent(event.value, event.timestamp);
+    });
 
     // Setup timer, if this timer reaches timeout, a long pressed happend
+    if (m_timerScheduler) {
+        m_schedulerTimerId = m_timerScheduler->registerTimer(&GpioButton::onSchedulerTimeout, this);
+        return true;
+    }
+
     m_timer = new QTimer(this);
     m_timer->setTimerType(Qt::PreciseTimer);
     m_timer->setSingleShot(!m_repeateLongPressed);
@@ -219,7 +454,9 @@ bool GpioButton::enable()
 void GpioButton::disable()
 {
     if (m_monitor) {
-        delete m_monitor;
+        // The button might get disabled from within the edge callback of the monitor
+        m_monitor->disable();
+        m_monitor->deleteLater();
         m_monitor = nullptr;
     }
 
@@ -227,6 +464,13 @@ void GpioButton::disable()
         delete m_timer;
         m_timer = nullptr;
     }
+
+    if (m_schedulerTimerId >= 0) {
+        if (m_timerScheduler)
+            m_timerScheduler->unregisterTimer(m_schedulerTimerId);
+
+        m_schedulerTimerId = -1;
+    }
 }
 
 /*! Prints the given \a gpioButton to \a debug. */
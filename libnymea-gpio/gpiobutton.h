@@ -31,17 +31,28 @@
 #ifndef GPIOBUTTON_H
 #define GPIOBUTTON_H
 
-#include <QElapsedTimer>
 #include <QTimer>
 #include <QObject>
+#include <QPointer>
 
 class GpioMonitor;
+class GpioTimerScheduler;
 
 class GpioButton : public QObject
 {
     Q_OBJECT
 public:
+    enum Gesture {
+        GestureClick,
+        GestureDoubleClick,
+        GestureMultiPress,
+        GestureHoldRelease
+    };
+    Q_ENUM(Gesture)
+
     explicit GpioButton(int gpio, QObject *parent = nullptr);
+    explicit GpioButton(const QString &lineName, QObject *parent = nullptr);
+    ~GpioButton() override;
 
     int gpioNumber() const;
 
@@ -54,6 +65,21 @@ public:
     int longPressedTimeout() const;
     void setLongPressedTimeout(int longPressedTimeout);
 
+    int debounceInterval() const;
+    void setDebounceInterval(int debounceInterval);
+
+    int clickTimeout() const;
+    void setClickTimeout(int clickTimeout);
+
+    int multiPressInterval() const;
+    void setMultiPressInterval(int multiPressInterval);
+
+    int maxPressCount() const;
+    void setMaxPressCount(int maxPressCount);
+
+    GpioTimerScheduler *timerScheduler() const;
+    void setTimerScheduler(GpioTimerScheduler *timerScheduler);
+
     QString name() const;
     void setName(const QString &name);
 
@@ -62,22 +88,39 @@ private:
     bool m_activeLow = false;
     bool m_repeateLongPressed = false;
     int m_longPressedTimeout = 250;
+    int m_debounceInterval = 10;
+    int m_clickTimeout = 500;
+    int m_multiPressInterval = 250;
+    int m_maxPressCount = 1;
     QString m_name;
 
     GpioMonitor *m_monitor = nullptr;
     QTimer *m_timer = nullptr;
-
-    QElapsedTimer m_time;
+    QPointer<GpioTimerScheduler> m_timerScheduler;
+    int m_schedulerTimerId = -1;
+
+    // Gesture state
+    bool m_pressed = false;
+    qint64 m_pressedTimestamp = 0;
+    qint64 m_releasedTimestamp = 0;
+    int m_pressCount = 0;
+    int m_lastPressDuration = 0;
+
+    void startButtonTimer(int interval, bool repeating);
+    void stopButtonTimer();
+    void finishGesture();
+    void onEdgeEvent(bool value, qint64 timestamp);
+    static void onSchedulerTimeout(void *context);
 
 signals:
     void clicked();
     void pressed();
     void released();
     void longPressed();
+    void gesture(GpioButton::Gesture gesture, int pressCount, int duration);
 
 private slots:
     void onTimeout();
-    void onValueChanged(bool value);
 
 public slots:
     bool enable();
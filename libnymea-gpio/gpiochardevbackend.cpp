@@ -0,0 +1,448 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioChardevBackend
+    \brief The GpioBackend implementation for the GPIO character device (\tt {/dev/gpiochipN}) interface.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    This backend uses line requests of the GPIO v2 uAPI. A line will be requested on \l{exportGpio()} and released on
+    \l{unexportGpio()}. Values will be accessed using a single \tt ioctl on the line request and interrupts will be read
+    as line events including the kernel timestamp and sequence number.
+
+    The global GPIO number used by the \l{Gpio} API gets mapped to a chip and line offset using \l{GpioChipInfo}.
+*/
+
+#include "gpiochardevbackend.h"
+#include "gpiochipinfo.h"
+
+#include <QDir>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+static const char *lineConsumer = "nymea-gpio";
+
+static void fillLineConfiguration(struct gpio_v2_line_config *config, quint64 flags, bool outputValue, int debouncePeriod)
+{
+    memset(config, 0, sizeof(*config));
+    config->flags = flags;
+    if (flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+        config->num_attrs = 1;
+        config->attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        config->attrs[0].attr.values = outputValue ? 1 : 0;
+        config->attrs[0].mask = 1;
+    } else if ((flags & GPIO_V2_LINE_FLAG_INPUT) && debouncePeriod > 0) {
+        config->num_attrs = 1;
+        config->attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+        config->attrs[0].attr.debounce_period_us = static_cast<__u32>(debouncePeriod);
+        config->attrs[0].mask = 1;
+    }
+}
+
+/*! Constructs the character device backend for the given \a gpio number. */
+GpioChardevBackend::GpioChardevBackend(int gpio) :
+    GpioBackend(gpio)
+{
+
+}
+
+/*! Destroys the backend and releases the line request. */
+GpioChardevBackend::~GpioChardevBackend()
+{
+    releaseLine();
+}
+
+/*! Returns true if at least one GPIO character device \tt {/dev/gpiochipN} does exist. */
+bool GpioChardevBackend::isAvailable()
+{
+    return !QDir("/dev").entryList(QStringList() << "gpiochip*", QDir::System).isEmpty();
+}
+
+/*! Returns the path of the character device providing this GPIO. The path is known once the GPIO has been exported. */
+QString GpioChardevBackend::chipPath() const
+{
+    return m_chipPath;
+}
+
+/*! Returns the line offset of this GPIO on the \l{chipPath()}{chip}. */
+unsigned int GpioChardevBackend::lineOffset() const
+{
+    return m_offset;
+}
+
+/*! Returns \l{Gpio::BackendCharacterDevice}. */
+Gpio::Backend GpioChardevBackend::type() const
+{
+    return Gpio::BackendCharacterDevice;
+}
+
+/*! Returns true if the line of this GPIO could be requested. The line will be requested with its current configuration.
+    If the line has already been requested by this backend, this function will return true. */
+bool GpioChardevBackend::exportGpio()
+{
+    if (m_requestFd >= 0) {
+        qCDebug(dcGpio()) << "GPIO" << m_gpio << "already requested.";
+        return true;
+    }
+
+    if (!m_resolved) {
+        m_resolved = GpioChipInfo::resolveLine(m_gpio, &m_chipPath, &m_offset);
+        if (!m_resolved) {
+            qCWarning(dcGpio()) << "Could not find a GPIO chip providing GPIO" << m_gpio;
+            return false;
+        }
+    }
+
+    m_chipFd = ::open(m_chipPath.toLocal8Bit().constData(), O_RDWR | O_CLOEXEC);
+    if (m_chipFd < 0) {
+        qCWarning(dcGpio()) << "Could not open GPIO chip" << m_chipPath << ":" << strerror(errno);
+        return false;
+    }
+
+    m_flags = 0;
+    m_outputValue.storeRelease(0);
+    if (!requestLine()) {
+        releaseLine();
+        return false;
+    }
+
+    return true;
+}
+
+/*! Releases the line request of this GPIO. */
+bool GpioChardevBackend::unexportGpio()
+{
+    releaseLine();
+    m_flags = 0;
+    return true;
+}
+
+/*! Reconfigures the line request to the given \a direction. Changing to output drives the line low. */
+bool GpioChardevBackend::setDirection(Gpio::Direction direction)
+{
+    quint64 flags = m_flags & ~static_cast<quint64>(GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_OUTPUT);
+    switch (direction) {
+    case Gpio::DirectionInput:
+        flags |= GPIO_V2_LINE_FLAG_INPUT;
+        break;
+    case Gpio::DirectionOutput:
+        // Edge detection is only allowed for inputs
+        flags &= ~static_cast<quint64>(GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING);
+        flags |= GPIO_V2_LINE_FLAG_OUTPUT;
+        m_outputValue.storeRelease(0);
+        break;
+    default:
+        return false;
+    }
+
+    return applyConfiguration(flags);
+}
+
+/*! Returns the direction reported by the line information of the chip. */
+Gpio::Direction GpioChardevBackend::direction()
+{
+    quint64 flags = 0;
+    if (!readLineFlags(&flags))
+        return Gpio::DirectionInvalid;
+
+    if (flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+        return Gpio::DirectionOutput;
+    } else if (flags & GPIO_V2_LINE_FLAG_INPUT) {
+        return Gpio::DirectionInput;
+    }
+
+    return Gpio::DirectionInvalid;
+}
+
+/*! Sets the \a value of the line using \tt GPIO_V2_LINE_SET_VALUES_IOCTL. */
+bool GpioChardevBackend::setValue(Gpio::Value value)
+{
+    if (m_requestFd < 0) {
+        qCWarning(dcGpio()) << "Could not set value of GPIO" << m_gpio << ", the line has not been requested.";
+        return false;
+    }
+
+    struct gpio_v2_line_values values;
+    memset(&values, 0, sizeof(values));
+    values.mask = 1;
+    values.bits = (value == Gpio::ValueHigh ? 1 : 0);
+    if (ioctl(m_requestFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+        qCWarning(dcGpio()) << "Could not set value of GPIO" << m_gpio << ":" << strerror(errno);
+        return false;
+    }
+
+    m_outputValue.storeRelease(value == Gpio::ValueHigh ? 1 : 0);
+    return true;
+}
+
+/*! Returns the value of the line using \tt GPIO_V2_LINE_GET_VALUES_IOCTL. */
+Gpio::Value GpioChardevBackend::value()
+{
+    if (m_requestFd < 0) {
+        qCWarning(dcGpio()) << "Could not get value of GPIO" << m_gpio << ", the line has not been requested.";
+        return Gpio::ValueInvalid;
+    }
+
+    struct gpio_v2_line_values values;
+    memset(&values, 0, sizeof(values));
+    values.mask = 1;
+    if (ioctl(m_requestFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        qCWarning(dcGpio()) << "Could not get value of GPIO" << m_gpio << ":" << strerror(errno);
+        return Gpio::ValueInvalid;
+    }
+
+    return (values.bits & 1) ? Gpio::ValueHigh : Gpio::ValueLow;
+}
+
+/*! Reconfigures the line request with or without the \tt GPIO_V2_LINE_FLAG_ACTIVE_LOW flag depending on \a activeLow. */
+bool GpioChardevBackend::setActiveLow(bool activeLow)
+{
+    quint64 flags = m_flags;
+    if (activeLow) {
+        flags |= GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+    } else {
+        flags &= ~static_cast<quint64>(GPIO_V2_LINE_FLAG_ACTIVE_LOW);
+    }
+
+    return applyConfiguration(flags);
+}
+
+/*! Returns true if the line information of the chip reports the line as active low. */
+bool GpioChardevBackend::activeLow()
+{
+    quint64 flags = 0;
+    if (!readLineFlags(&flags))
+        return false;
+
+    return flags & GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+}
+
+/*! Reconfigures the edge detection of the line request to the given \a edge. Edge detection implies the input direction. */
+bool GpioChardevBackend::setEdgeInterrupt(Gpio::Edge edge)
+{
+    quint64 flags = m_flags & ~static_cast<quint64>(GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING);
+    switch (edge) {
+    case Gpio::EdgeFalling:
+        flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+        break;
+    case Gpio::EdgeRising:
+        flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+        break;
+    case Gpio::EdgeBoth:
+        flags |= GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+        break;
+    case Gpio::EdgeNone:
+        break;
+    }
+
+    if (edge != Gpio::EdgeNone) {
+        flags &= ~static_cast<quint64>(GPIO_V2_LINE_FLAG_OUTPUT);
+        flags |= GPIO_V2_LINE_FLAG_INPUT;
+    }
+
+    return applyConfiguration(flags);
+}
+
+/*! Returns the edge detection reported by the line information of the chip. */
+Gpio::Edge GpioChardevBackend::edgeInterrupt()
+{
+    quint64 flags = 0;
+    if (!readLineFlags(&flags))
+        return Gpio::EdgeNone;
+
+    bool rising = flags & GPIO_V2_LINE_FLAG_EDGE_RISING;
+    bool falling = flags & GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    if (rising && falling) {
+        return Gpio::EdgeBoth;
+    } else if (rising) {
+        return Gpio::EdgeRising;
+    } else if (falling) {
+        return Gpio::EdgeFalling;
+    }
+
+    return Gpio::EdgeNone;
+}
+
+/*! Sets the suggested size of the kernel line event buffer to \a eventBufferSize. A size of 0 uses the kernel default.
+    The size will be applied the next time the line gets requested. */
+void GpioChardevBackend::setEventBufferSize(int eventBufferSize)
+{
+    m_eventBufferSize = qMax(eventBufferSize, 0);
+}
+
+/*! Requests the kernel to debounce the input line with the given \a debouncePeriod in microseconds. The kernel uses the
+    debounce support of the GPIO controller if available, otherwise it debounces the line in software. Bouncing edges get
+    absorbed in the kernel and will not be queued as line events. Returns false if the kernel rejected the period. */
+bool GpioChardevBackend::setDebounce(int debouncePeriod)
+{
+    int previousPeriod = m_debouncePeriod;
+    m_debouncePeriod = qMax(debouncePeriod, 0);
+    if (m_requestFd < 0 || !(m_flags & GPIO_V2_LINE_FLAG_INPUT))
+        return true;
+
+    if (applyConfiguration(m_flags))
+        return true;
+
+    qCWarning(dcGpio()) << "Could not set the debounce period of GPIO" << m_gpio << "to" << m_debouncePeriod << "us.";
+    m_debouncePeriod = previousPeriod;
+
+    // The failed request might have released the line
+    if (m_requestFd < 0)
+        requestLine();
+
+    return false;
+}
+
+/*! Returns the descriptor of the line request, which becomes readable once line events are queued. */
+int GpioChardevBackend::eventFd()
+{
+    return m_requestFd;
+}
+
+/*! Returns QSocketNotifier::Read, since line events will be read from the line request. */
+QSocketNotifier::Type GpioChardevBackend::eventNotifierType() const
+{
+    return QSocketNotifier::Read;
+}
+
+/*! Reads at most \a maxEvents queued line events into \a events using a single \tt read. */
+int GpioChardevBackend::readEvents(GpioEvent *events, int maxEvents)
+{
+    if (maxEvents <= 0 || m_requestFd < 0)
+        return 0;
+
+    struct gpio_v2_line_event lineEvents[64];
+    int count = qMin(maxEvents, 64);
+    ssize_t bytes = ::read(m_requestFd, lineEvents, count * sizeof(struct gpio_v2_line_event));
+    if (bytes < 0) {
+        if (errno == EAGAIN)
+            return 0;
+
+        qCWarning(dcGpio()) << "Could not read line events of GPIO" << m_gpio << ":" << strerror(errno);
+        return -1;
+    }
+
+    count = static_cast<int>(bytes / sizeof(struct gpio_v2_line_event));
+    for (int i = 0; i < count; i++) {
+        events[i].value = (lineEvents[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+        events[i].timestamp = static_cast<qint64>(lineEvents[i].timestamp_ns);
+        events[i].sequence = lineEvents[i].line_seqno;
+    }
+
+    return count;
+}
+
+bool GpioChardevBackend::requestLine()
+{
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    request.offsets[0] = m_offset;
+    request.num_lines = 1;
+    request.event_buffer_size = static_cast<__u32>(m_eventBufferSize);
+    strncpy(request.consumer, lineConsumer, sizeof(request.consumer) - 1);
+    fillLineConfiguration(&request.config, m_flags, m_outputValue.loadAcquire() != 0, m_debouncePeriod);
+
+    if (ioctl(m_chipFd, GPIO_V2_GET_LINE_IOCTL, &request) < 0) {
+        qCWarning(dcGpio()) << "Could not request line" << m_offset << "of" << m_chipPath << "for GPIO" << m_gpio << ":" << strerror(errno);
+        return false;
+    }
+
+    // Line events get read on demand, never block the caller
+    m_requestFd = request.fd;
+    fcntl(m_requestFd, F_SETFL, fcntl(m_requestFd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+bool GpioChardevBackend::applyConfiguration(quint64 flags)
+{
+    if (m_requestFd < 0) {
+        qCWarning(dcGpio()) << "Could not configure GPIO" << m_gpio << ", the line has not been requested.";
+        return false;
+    }
+
+    struct gpio_v2_line_config config;
+    fillLineConfiguration(&config, flags, m_outputValue.loadAcquire() != 0, m_debouncePeriod);
+    if (ioctl(m_requestFd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) >= 0) {
+        m_flags = flags;
+        return true;
+    }
+
+    // Not every kernel supports changing every flag on an existing request, request the line again
+    qCDebug(dcGpio()) << "Could not reconfigure line of GPIO" << m_gpio << ":" << strerror(errno) << "Requesting the line again.";
+    quint64 previousFlags = m_flags;
+    ::close(m_requestFd);
+    m_requestFd = -1;
+
+    m_flags = flags;
+    if (requestLine())
+        return true;
+
+    m_flags = previousFlags;
+    requestLine();
+    return false;
+}
+
+bool GpioChardevBackend::readLineFlags(quint64 *flags)
+{
+    if (m_chipFd < 0) {
+        qCWarning(dcGpio()) << "Could not read line information of GPIO" << m_gpio << ", the line has not been requested.";
+        return false;
+    }
+
+    struct gpio_v2_line_info info;
+    memset(&info, 0, sizeof(info));
+    info.offset = m_offset;
+    if (ioctl(m_chipFd, GPIO_V2_GET_LINEINFO_IOCTL, &info) < 0) {
+        qCWarning(dcGpio()) << "Could not read line information of GPIO" << m_gpio << ":" << strerror(errno);
+        return false;
+    }
+
+    *flags = info.flags;
+    return true;
+}
+
+void GpioChardevBackend::releaseLine()
+{
+    if (m_requestFd >= 0) {
+        ::close(m_requestFd);
+        m_requestFd = -1;
+    }
+
+    if (m_chipFd >= 0) {
+        ::close(m_chipFd);
+        m_chipFd = -1;
+    }
+}
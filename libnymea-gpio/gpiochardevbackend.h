@@ -0,0 +1,94 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOCHARDEVBACKEND_H
+#define GPIOCHARDEVBACKEND_H
+
+#include <QAtomicInteger>
+
+#include "gpiobackend.h"
+
+class GpioChardevBackend : public GpioBackend
+{
+public:
+    explicit GpioChardevBackend(int gpio);
+    ~GpioChardevBackend() override;
+
+    static bool isAvailable();
+
+    QString chipPath() const;
+    unsigned int lineOffset() const;
+
+    Gpio::Backend type() const override;
+
+    bool exportGpio() override;
+    bool unexportGpio() override;
+
+    bool setDirection(Gpio::Direction direction) override;
+    Gpio::Direction direction() override;
+
+    bool setValue(Gpio::Value value) override;
+    Gpio::Value value() override;
+
+    bool setActiveLow(bool activeLow) override;
+    bool activeLow() override;
+
+    bool setEdgeInterrupt(Gpio::Edge edge) override;
+    Gpio::Edge edgeInterrupt() override;
+
+    void setEventBufferSize(int eventBufferSize) override;
+    bool setDebounce(int debouncePeriod) override;
+
+    int eventFd() override;
+    QSocketNotifier::Type eventNotifierType() const override;
+    int readEvents(GpioEvent *events, int maxEvents) override;
+
+private:
+    QString m_chipPath;
+    unsigned int m_offset = 0;
+    bool m_resolved = false;
+
+    int m_chipFd = -1;
+    int m_requestFd = -1;
+
+    // The configuration of the line request (GPIO_V2_LINE_FLAG_*)
+    quint64 m_flags = 0;
+    QAtomicInt m_outputValue;
+    int m_eventBufferSize = 0;
+    int m_debouncePeriod = 0;
+
+    bool requestLine();
+    bool applyConfiguration(quint64 flags);
+    bool readLineFlags(quint64 *flags);
+    void releaseLine();
+
+};
+
+#endif // GPIOCHARDEVBACKEND_H
@@ -0,0 +1,347 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioChipInfo
+    \brief Describes a GPIO character device and provides the lookup of GPIO lines by number or name.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The global GPIO numbers depend on the probe order of the GPIO chips and change between kernels and boards. Most
+    boards name their lines in the device tree instead, i.e. \tt GPIO17 or \tt STATUS_LED, so looking up a line by its
+    name is the portable way to address it.
+
+    The chips \tt {/dev/gpiochipN} will be enumerated once on the first lookup. The name and global number of every line
+    are kept in a cache, so any further lookup is a hash hit and does not access the kernel. If chips appear or
+    disappear at runtime, i.e. an USB GPIO expander has been plugged, the cache can be rebuilt using \l{refresh()}.
+
+    The \l{Gpio}, \l{GpioMonitor} and \l{GpioButton} classes can be constructed from a line name directly:
+
+    \code
+        Gpio *led = new Gpio("STATUS_LED", this);
+        if (!led->exportGpio()) {
+            qWarning() << "Could not export the status LED.";
+            return;
+        }
+    \endcode
+
+    The global number of a line is the base of its chip in the sysfs interface plus the offset of the line. The base will
+    be assigned using the character device \tt gpiochipX belonging to the sysfs chip. If the base of a chip can not be
+    determined, i.e. the kernel has no sysfs interface, its lines have no global number and can neither be looked up by
+    number nor used by the classes addressing them by number. The numbers are never guessed, since a wrong guess would
+    silently drive another pin.
+
+    \sa GpioLineInfo
+*/
+
+/*!
+    \class GpioLineInfo
+    \brief Describes a single line of a \l{GpioChipInfo}{GPIO chip}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The line info contains the \c name of the line, the \c chipPath and line \c offset used by the character device
+    interface and the global \c gpio number used by the \l{Gpio} API. The \c gpio number is -1 if the chip has no
+    global number.
+*/
+
+#include "gpiochipinfo.h"
+#include "gpio.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QFileInfo>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+static QMutex chipCacheMutex;
+static bool chipCacheLoaded = false;
+static QList<GpioChipInfo> chipCache;
+static QHash<QString, GpioLineInfo> lineNameCache;
+
+static QByteArray readSysfsFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QByteArray();
+
+    return file.readAll().trimmed();
+}
+
+static QList<GpioChipInfo> readChips()
+{
+    QList<GpioChipInfo> chips;
+
+    QDir devDirectory("/dev");
+    QStringList entries = devDirectory.entryList(QStringList() << "gpiochip*", QDir::System);
+    std::sort(entries.begin(), entries.end(), [](const QString &first, const QString &second) {
+        return first.mid(8).toInt() < second.mid(8).toInt();
+    });
+
+    foreach (const QString &entry, entries) {
+        GpioChipInfo chip;
+        chip.path = devDirectory.filePath(entry);
+        chip.name = entry;
+
+        int fd = ::open(chip.path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            qCWarning(dcGpio()) << "GpioChipInfo: Could not open GPIO chip" << chip.path << ":" << strerror(errno);
+            continue;
+        }
+
+        struct gpiochip_info info;
+        memset(&info, 0, sizeof(info));
+        if (ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info) < 0) {
+            qCWarning(dcGpio()) << "GpioChipInfo: Could not read chip information of" << chip.path << ":" << strerror(errno);
+            ::close(fd);
+            continue;
+        }
+
+        chip.label = QString::fromLatin1(info.label);
+        chip.lines = info.lines;
+
+        // Unnamed lines or lines which could not be read keep an empty name
+        for (unsigned int offset = 0; offset < chip.lines; offset++) {
+            struct gpio_v2_line_info lineInfo;
+            memset(&lineInfo, 0, sizeof(lineInfo));
+            lineInfo.offset = offset;
+            if (ioctl(fd, GPIO_V2_GET_LINEINFO_IOCTL, &lineInfo) < 0) {
+                chip.lineNames.append(QString());
+            } else {
+                chip.lineNames.append(QString::fromLatin1(lineInfo.name));
+            }
+        }
+
+        ::close(fd);
+        chips.append(chip);
+    }
+
+    return chips;
+}
+
+// Returns the name of the character device of a chip in the sysfs interface, or an empty string if it is not unique
+static QString sysfsChipDeviceName(const QDir &sysfsDirectory, const QString &sysfsChip)
+{
+    // Chips without parent device link their own character device
+    QString devicePath = QFileInfo(sysfsDirectory.filePath(sysfsChip + "/device")).canonicalFilePath();
+    if (devicePath.isEmpty())
+        return QString();
+
+    QDir deviceDirectory(devicePath);
+    if (deviceDirectory.dirName().startsWith("gpiochip"))
+        return deviceDirectory.dirName();
+
+    // Otherwise the character device is a child of the parent device, which is ambiguous for parents providing several chips
+    QStringList devices = deviceDirectory.entryList(QStringList() << "gpiochip*", QDir::Dirs | QDir::NoDotAndDotDot);
+    if (devices.count() != 1)
+        return QString();
+
+    return devices.first();
+}
+
+static void assignBases(QList<GpioChipInfo> &chips)
+{
+    // Only the sysfs interface knows the global base of each chip
+    QDir sysfsDirectory("/sys/class/gpio");
+    QStringList sysfsChips = sysfsDirectory.entryList(QStringList() << "gpiochip*", QDir::Dirs | QDir::NoDotAndDotDot);
+    foreach (const QString &sysfsChip, sysfsChips) {
+        bool baseOk = false;
+        bool countOk = false;
+        int base = readSysfsFile(sysfsDirectory.filePath(sysfsChip + "/base")).toInt(&baseOk);
+        int count = readSysfsFile(sysfsDirectory.filePath(sysfsChip + "/ngpio")).toInt(&countOk);
+        if (!baseOk || !countOk)
+            continue;
+
+        QString deviceName = sysfsChipDeviceName(sysfsDirectory, sysfsChip);
+        if (deviceName.isEmpty()) {
+            qCDebug(dcGpio()) << "GpioChipInfo: Could not determine the character device of" << sysfsChip << ". Its lines have no global number.";
+            continue;
+        }
+
+        for (int i = 0; i < chips.count(); i++) {
+            GpioChipInfo &chip = chips[i];
+            if (chip.name != deviceName)
+                continue;
+
+            if (static_cast<int>(chip.lines) == count) {
+                chip.base = base;
+            } else {
+                qCWarning(dcGpio()) << "GpioChipInfo: The line count of" << chip.path << "does not match" << sysfsChip << ". Its lines have no global number.";
+            }
+            break;
+        }
+    }
+
+    // Without a known base the global numbers would be guessed and might address the wrong line
+    foreach (const GpioChipInfo &chip, chips) {
+        if (chip.base < 0)
+            qCWarning(dcGpio()) << "GpioChipInfo: Could not determine the global base of" << chip.path << ". Its lines can not be addressed by number.";
+    }
+}
+
+// Requires the chipCacheMutex to be locked
+static void loadChipCache()
+{
+    if (chipCacheLoaded)
+        return;
+
+    chipCache = readChips();
+    assignBases(chipCache);
+
+    lineNameCache.clear();
+    foreach (const GpioChipInfo &chip, chipCache) {
+        for (int offset = 0; offset < chip.lineNames.count(); offset++) {
+            const QString &lineName = chip.lineNames.at(offset);
+            if (lineName.isEmpty())
+                continue;
+
+            // Line names should be unique, if not the first chip wins
+            if (lineNameCache.contains(lineName)) {
+                qCDebug(dcGpio()) << "GpioChipInfo: The line name" << lineName << "is used more than once. Ignoring it on" << chip.path;
+                continue;
+            }
+
+            GpioLineInfo line;
+            line.name = lineName;
+            line.chipPath = chip.path;
+            line.offset = static_cast<unsigned int>(offset);
+            line.gpio = chip.base >= 0 ? chip.base + offset : -1;
+            lineNameCache.insert(lineName, line);
+        }
+    }
+
+    chipCacheLoaded = true;
+    qCDebug(dcGpio()) << "GpioChipInfo: Found" << chipCache.count() << "GPIO chips with" << lineNameCache.count() << "named lines";
+}
+
+/*! Returns true if this line info describes an existing line. */
+bool GpioLineInfo::isValid() const
+{
+    return !chipPath.isEmpty();
+}
+
+/*! Returns the list of available GPIO chips. The chips will be enumerated on the first call only.
+
+    \sa refresh()
+*/
+QList<GpioChipInfo> GpioChipInfo::chips()
+{
+    QMutexLocker locker(&chipCacheMutex);
+    loadChipCache();
+    return chipCache;
+}
+
+/*! Discards the cached chips and line names. They will be enumerated again on the next lookup. */
+void GpioChipInfo::refresh()
+{
+    QMutexLocker locker(&chipCacheMutex);
+    chipCacheLoaded = false;
+    chipCache.clear();
+    lineNameCache.clear();
+}
+
+/*! Returns the info of the line with the given \a lineName. The returned info is invalid if no chip provides a line with that name. */
+GpioLineInfo GpioChipInfo::findLine(const QString &lineName)
+{
+    QMutexLocker locker(&chipCacheMutex);
+    loadChipCache();
+    GpioLineInfo line = lineNameCache.value(lineName);
+    if (!line.isValid())
+        qCWarning(dcGpio()) << "GpioChipInfo: Could not find a GPIO line named" << lineName;
+
+    return line;
+}
+
+/*! Returns the info of the line with the global \a gpio number. The returned info is invalid if no chip provides that number. */
+GpioLineInfo GpioChipInfo::findLine(int gpio)
+{
+    GpioLineInfo line;
+    if (gpio < 0)
+        return line;
+
+    QMutexLocker locker(&chipCacheMutex);
+    loadChipCache();
+    foreach (const GpioChipInfo &chip, chipCache) {
+        if (chip.base < 0 || gpio < chip.base || gpio >= chip.base + static_cast<int>(chip.lines))
+            continue;
+
+        line.offset = static_cast<unsigned int>(gpio - chip.base);
+        line.name = chip.lineNames.value(static_cast<int>(line.offset));
+        line.chipPath = chip.path;
+        line.gpio = gpio;
+        break;
+    }
+
+    return line;
+}
+
+/*! Returns the global GPIO number of the line with the given \a lineName, or -1 if the line could not be found or has no global number. */
+int GpioChipInfo::gpioNumber(const QString &lineName)
+{
+    GpioLineInfo line = findLine(lineName);
+    if (line.isValid() && line.gpio < 0)
+        qCWarning(dcGpio()) << "GpioChipInfo: The GPIO line" << lineName << "has no global number, the base of" << line.chipPath << "is unknown.";
+
+    return line.gpio;
+}
+
+/*! Maps the global \a gpio number to the \a chipPath and line \a offset of the character device. Returns false if the
+    number could not be mapped to any chip. */
+bool GpioChipInfo::resolveLine(int gpio, QString *chipPath, unsigned int *offset)
+{
+    GpioLineInfo line = findLine(gpio);
+    if (!line.isValid())
+        return false;
+
+    *chipPath = line.chipPath;
+    *offset = line.offset;
+    return true;
+}
+
+QDebug operator<<(QDebug debug, const GpioLineInfo &lineInfo)
+{
+    debug.nospace() << "GpioLineInfo(" << lineInfo.gpio << ", " << lineInfo.name << ", " << lineInfo.chipPath << ":" << lineInfo.offset << ")";
+    return debug.space();
+}
+
+QDebug operator<<(QDebug debug, const GpioChipInfo &chipInfo)
+{
+    debug.nospace() << "GpioChipInfo(" << chipInfo.path << ", " << chipInfo.label << ", lines: " << chipInfo.lines << ", base: " << chipInfo.base << ")";
+    return debug.space();
+}
@@ -0,0 +1,68 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOCHIPINFO_H
+#define GPIOCHIPINFO_H
+
+#include <QDebug>
+#include <QStringList>
+
+struct GpioLineInfo
+{
+    QString name;
+    QString chipPath;
+    unsigned int offset = 0;
+    int gpio = -1;
+
+    bool isValid() const;
+};
+
+struct GpioChipInfo
+{
+    QString path;
+    QString name;
+    QString label;
+    unsigned int lines = 0;
+    int base = -1;
+    QStringList lineNames;
+
+    static QList<GpioChipInfo> chips();
+    static void refresh();
+
+    static GpioLineInfo findLine(const QString &lineName);
+    static GpioLineInfo findLine(int gpio);
+    static int gpioNumber(const QString &lineName);
+    static bool resolveLine(int gpio, QString *chipPath, unsigned int *offset);
+};
+
+QDebug operator<< (QDebug debug, const GpioLineInfo &lineInfo);
+QDebug operator<< (QDebug debug, const GpioChipInfo &chipInfo);
+
+#endif // GPIOCHIPINFO_H
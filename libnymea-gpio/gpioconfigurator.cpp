@@ -0,0 +1,185 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioConfigurator
+    \brief Exports and configures many GPIOs at once without blocking the caller.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Bringing up GPIOs one after the other costs several blocking sysfs writes per GPIO on the calling thread, and every
+    export waits for udev to adjust the permissions of the new GPIO. The GpioConfigurator performs the configuration on a
+    worker thread and pipelines it: first all GPIOs get exported, then the exports are awaited together, and finally the
+    attributes of each GPIO get written. Using the character device backend, exporting means requesting the line, which
+    does not require any waiting at all.
+
+    For each \l{GpioConfig} the \l{gpioConfigured()} signal will be emitted as soon as the GPIO has been configured. The
+    receiver takes the ownership of the passed Gpio object, which lives in the thread of the GpioConfigurator. If the
+    GPIO could not be configured, the Gpio passed is a \c nullptr. Once all GPIOs have been processed, \l{finished()}
+    will be emitted.
+
+    \code
+        GpioConfig led;
+        led.gpio = 17;
+        led.direction = Gpio::DirectionOutput;
+        led.value = Gpio::ValueLow;
+
+        GpioConfig button;
+        button.gpio = 27;
+        button.direction = Gpio::DirectionInput;
+        button.activeLow = true;
+        button.edge = Gpio::EdgeBoth;
+
+        GpioConfigurator *configurator = new GpioConfigurator(this);
+        connect(configurator, &GpioConfigurator::gpioConfigured, this, [this](const GpioConfig &config, Gpio *gpio){
+            if (!gpio) {
+                qWarning() << "Could not configure GPIO" << config.gpio;
+                return;
+            }
+            gpio->setParent(this);
+        });
+        connect(configurator, &GpioConfigurator::finished, configurator, &GpioConfigurator::deleteLater);
+        configurator->apply({led, button});
+    \endcode
+
+    \sa Gpio, GpioBank
+*/
+
+/*!
+    \class GpioConfig
+    \brief Describes the desired configuration of one GPIO for the \l{GpioConfigurator}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The \c direction defaults to Gpio::DirectionInvalid, which only exports the GPIO. The \c edge will only be set for
+    inputs and the \c value only for outputs, a value of Gpio::ValueInvalid leaves the output untouched.
+*/
+
+/*! \fn void GpioConfigurator::gpioConfigured(const GpioConfig &config, Gpio *gpio);
+    This signal will be emitted once the GPIO described by \a config has been configured. The receiver takes the ownership
+    of \a gpio. If the GPIO could not be exported or configured, \a gpio is a \c nullptr.
+*/
+
+/*! \fn void GpioConfigurator::finished(bool success);
+    This signal will be emitted once all GPIOs passed to \l{apply()} have been processed. \a success is true if all of them
+    could be configured.
+*/
+
+#include "gpioconfigurator.h"
+#include "gpioconfiguratorthread.h"
+
+/*! Constructs a GpioConfigurator with the given \a parent. */
+GpioConfigurator::GpioConfigurator(QObject *parent) :
+    QObject(parent)
+{
+    qRegisterMetaType<GpioConfig>();
+}
+
+/*! Destroys the GpioConfigurator. A running configuration will be interrupted, the Gpio objects which have not been
+    reported yet get destroyed and thereby unexported. */
+GpioConfigurator::~GpioConfigurator()
+{
+    if (!m_thread)
+        return;
+
+    m_thread->requestInterruption();
+    m_thread->wait();
+    for (int i = 0; i < m_configs.count(); i++)
+        delete m_thread->takeGpio(i);
+
+    delete m_thread;
+}
+
+/*! Returns the time in milliseconds to wait for each GPIO to become accessible after exporting it.
+
+    \sa Gpio::setExportTimeout()
+*/
+int GpioConfigurator::exportTimeout() const
+{
+    return m_exportTimeout;
+}
+
+/*! Sets the time in milliseconds to wait for each GPIO to become accessible after exporting it to \a exportTimeout.
+    The timeout applies to configurations started afterwards. */
+void GpioConfigurator::setExportTimeout(int exportTimeout)
+{
+    m_exportTimeout = qMax(exportTimeout, 0);
+}
+
+/*! Returns true while a configuration started by \l{apply()} is in progress. */
+bool GpioConfigurator::isRunning() const
+{
+    return m_thread != nullptr;
+}
+
+/*! Starts exporting and configuring the GPIOs described by \a configs on a worker thread. Returns false if a configuration
+    is already in progress. The results will be reported by \l{gpioConfigured()} and \l{finished()}. */
+bool GpioConfigurator::apply(const QList<GpioConfig> &configs)
+{
+    if (m_thread) {
+        qCWarning(dcGpio()) << "GpioConfigurator: A configuration is already in progress.";
+        return false;
+    }
+
+    qCDebug(dcGpio()) << "GpioConfigurator: Configure" << configs.count() << "GPIOs";
+    m_configs = configs;
+    m_success = true;
+
+    m_thread = new GpioConfiguratorThread(this, m_configs, m_exportTimeout);
+    connect(m_thread, &QThread::finished, this, &GpioConfigurator::onThreadFinished, Qt::QueuedConnection);
+    m_thread->start();
+    return true;
+}
+
+void GpioConfigurator::onGpioConfigured(int index)
+{
+    if (!m_thread || index < 0 || index >= m_configs.count())
+        return;
+
+    Gpio *gpio = m_thread->takeGpio(index);
+    if (!gpio)
+        m_success = false;
+
+    emit gpioConfigured(m_configs.at(index), gpio);
+}
+
+void GpioConfigurator::onThreadFinished()
+{
+    if (!m_thread)
+        return;
+
+    // The results have been queued before the thread finished, so all of them have been delivered already
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    qCDebug(dcGpio()) << "GpioConfigurator: Configuration finished" << (m_success ? "successfully." : "with errors.");
+    emit finished(m_success);
+}
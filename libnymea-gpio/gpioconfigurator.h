@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOCONFIGURATOR_H
+#define GPIOCONFIGURATOR_H
+
+#include <QObject>
+#include <QList>
+
+#include "gpio.h"
+
+class GpioConfiguratorThread;
+
+struct GpioConfig
+{
+    int gpio = -1;
+    Gpio::Direction direction = Gpio::DirectionInvalid;
+    bool activeLow = false;
+    Gpio::Edge edge = Gpio::EdgeNone;
+    Gpio::Value value = Gpio::ValueInvalid;
+};
+
+class GpioConfigurator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioConfigurator(QObject *parent = nullptr);
+    ~GpioConfigurator() override;
+
+    int exportTimeout() const;
+    void setExportTimeout(int exportTimeout);
+
+    bool isRunning() const;
+    bool apply(const QList<GpioConfig> &configs);
+
+signals:
+    void gpioConfigured(const GpioConfig &config, Gpio *gpio);
+    void finished(bool success);
+
+private slots:
+    void onGpioConfigured(int index);
+    void onThreadFinished();
+
+private:
+    GpioConfiguratorThread *m_thread = nullptr;
+    QList<GpioConfig> m_configs;
+    int m_exportTimeout = 1000;
+    bool m_success = true;
+
+};
+
+Q_DECLARE_METATYPE(GpioConfig)
+
+#endif // GPIOCONFIGURATOR_H
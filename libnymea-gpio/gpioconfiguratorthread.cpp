@@ -0,0 +1,152 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioConfiguratorThread
+    \brief The worker thread of a \l{GpioConfigurator}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The thread creates the Gpio objects, writes the exports of all sysfs GPIOs at once and waits for them afterwards, so
+    udev can process all of them in parallel. Each configured Gpio gets moved to the thread of the configurator before
+    it will be reported.
+*/
+
+#include "gpioconfiguratorthread.h"
+#include "gpiosysfsbackend.h"
+
+/*! Constructs the thread applying the given \a configs for \a configurator, waiting at most \a exportTimeout milliseconds
+    for each exported GPIO. */
+GpioConfiguratorThread::GpioConfiguratorThread(GpioConfigurator *configurator, const QList<GpioConfig> &configs, int exportTimeout) :
+    QThread(),
+    m_configurator(configurator),
+    m_targetThread(configurator->thread()),
+    m_configs(configs),
+    m_gpios(configs.count(), nullptr),
+    m_exportTimeout(exportTimeout)
+{
+    setObjectName("gpio-configurator");
+}
+
+/*! Waits for the thread and destroys it. */
+GpioConfiguratorThread::~GpioConfiguratorThread()
+{
+    requestInterruption();
+    wait();
+}
+
+/*! Returns the Gpio configured for the config at \a index and releases the ownership. Returns \c nullptr if the GPIO
+    could not be configured or has been taken already. */
+Gpio *GpioConfiguratorThread::takeGpio(int index)
+{
+    QMutexLocker locker(&m_gpiosMutex);
+    Gpio *gpio = m_gpios.at(index);
+    m_gpios[index] = nullptr;
+    return gpio;
+}
+
+/*! Exports and configures all GPIOs. */
+void GpioConfiguratorThread::run()
+{
+    QVector<bool> exportWritten(m_configs.count(), false);
+
+    // Write all exports first, udev will adjust the permissions of all of them in parallel
+    for (int i = 0; i < m_configs.count() && !isInterruptionRequested(); i++) {
+        Gpio *gpio = new Gpio(m_configs.at(i).gpio);
+        gpio->setExportTimeout(m_exportTimeout);
+        m_gpiosMutex.lock();
+        m_gpios[i] = gpio;
+        m_gpiosMutex.unlock();
+
+        if (gpio->backendType() != Gpio::BackendSysfs)
+            continue;
+
+        // The canonical gpioDirectory() is empty for a GPIO which has not been exported yet, ask the backend instead
+        GpioSysfsBackend *backend = static_cast<GpioSysfsBackend *>(gpio->backend());
+        if (backend->isExported())
+            continue;
+
+        exportWritten[i] = backend->writeExport();
+    }
+
+    for (int i = 0; i < m_configs.count() && !isInterruptionRequested(); i++) {
+        m_gpiosMutex.lock();
+        Gpio *gpio = m_gpios.at(i);
+        m_gpiosMutex.unlock();
+        const GpioConfig &config = m_configs.at(i);
+
+        if (exportWritten.at(i)) {
+            GpioSysfsBackend *backend = static_cast<GpioSysfsBackend *>(gpio->backend());
+            if (!backend->waitForExport(m_exportTimeout)) {
+                reportGpio(i, nullptr);
+                continue;
+            }
+        }
+
+        if (!gpio->exportGpio() || !configureGpio(gpio, config)) {
+            qCWarning(dcGpio()) << "GpioConfigurator: Could not configure GPIO" << config.gpio;
+            reportGpio(i, nullptr);
+            continue;
+        }
+
+        reportGpio(i, gpio);
+    }
+}
+
+bool GpioConfiguratorThread::configureGpio(Gpio *gpio, const GpioConfig &config)
+{
+    if (config.direction == Gpio::DirectionInvalid)
+        return true;
+
+    if (!gpio->setDirection(config.direction))
+        return false;
+
+    if (!gpio->setActiveLow(config.activeLow))
+        return false;
+
+    if (config.direction == Gpio::DirectionInput)
+        return gpio->setEdgeInterrupt(config.edge);
+
+    if (config.value != Gpio::ValueInvalid)
+        return gpio->setValue(config.value);
+
+    return true;
+}
+
+void GpioConfiguratorThread::reportGpio(int index, Gpio *gpio)
+{
+    if (gpio) {
+        gpio->moveToThread(m_targetThread);
+    } else {
+        delete takeGpio(index);
+    }
+
+    QMetaObject::invokeMethod(m_configurator, "onGpioConfigured", Qt::QueuedConnection, Q_ARG(int, index));
+}
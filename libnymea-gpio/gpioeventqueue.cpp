@@ -0,0 +1,147 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioEventQueue
+    \brief A preallocated ring buffer of \l{GpioEvent}{GpioEvents}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The queue allocates its storage once, the capacity will be rounded up to the next power of two. Events can be
+    written directly into the buffer using \l{writeBuffer()} and \l{commit()}, which allows to read a batch of events
+    from the kernel without copying them through temporary buffers.
+
+    The queue is lock-free for one producer and one consumer thread. The producer uses \l{enqueue()}, \l{writeBuffer()} and
+    \l{commit()}, the consumer uses \l{dequeue()}, \l{at()} and \l{clear()}. Changing the \l{capacity()} is not thread-safe.
+*/
+
+#include "gpioeventqueue.h"
+
+/*! Constructs a GpioEventQueue which can hold at least \a capacity events. */
+GpioEventQueue::GpioEventQueue(int capacity)
+{
+    setCapacity(capacity);
+}
+
+/*! Returns the number of events this queue can hold. */
+int GpioEventQueue::capacity() const
+{
+    return m_buffer.count();
+}
+
+/*! Reallocates the queue to hold at least \a capacity events. Queued events will be discarded. */
+void GpioEventQueue::setCapacity(int capacity)
+{
+    quint32 size = 1;
+    while (size < static_cast<quint32>(qMax(capacity, 1)))
+        size <<= 1;
+
+    m_buffer = QVector<GpioEvent>(static_cast<int>(size));
+    m_data = m_buffer.data();
+    m_mask = size - 1;
+    m_readIndex.storeRelease(0);
+    m_writeIndex.storeRelease(0);
+}
+
+/*! Returns the number of queued events. */
+int GpioEventQueue::count() const
+{
+    return static_cast<int>(m_writeIndex.loadAcquire() - m_readIndex.loadAcquire());
+}
+
+/*! Returns the number of events which can be enqueued until the queue is full. */
+int GpioEventQueue::freeSpace() const
+{
+    return capacity() - count();
+}
+
+/*! Returns true if there are no queued events. */
+bool GpioEventQueue::isEmpty() const
+{
+    return count() == 0;
+}
+
+/*! Returns true if the queue is full. */
+bool GpioEventQueue::isFull() const
+{
+    return count() == capacity();
+}
+
+/*! Discards all queued events. */
+void GpioEventQueue::clear()
+{
+    m_readIndex.storeRelease(m_writeIndex.loadAcquire());
+}
+
+/*! Appends the \a event to the queue. Returns false if the queue is full. */
+bool GpioEventQueue::enqueue(const GpioEvent &event)
+{
+    if (isFull())
+        return false;
+
+    quint32 writeIndex = m_writeIndex.loadAcquire();
+    m_data[writeIndex & m_mask] = event;
+    m_writeIndex.storeRelease(writeIndex + 1);
+    return true;
+}
+
+/*! Moves at most \a maxEvents of the oldest events into \a events. Returns the number of events dequeued. */
+int GpioEventQueue::dequeue(GpioEvent *events, int maxEvents)
+{
+    quint32 readIndex = m_readIndex.loadAcquire();
+    int dequeued = qMin(maxEvents, static_cast<int>(m_writeIndex.loadAcquire() - readIndex));
+    for (int i = 0; i < dequeued; i++) {
+        events[i] = m_data[(readIndex + static_cast<quint32>(i)) & m_mask];
+    }
+
+    m_readIndex.storeRelease(readIndex + static_cast<quint32>(dequeued));
+    return dequeued;
+}
+
+/*! Returns the position where the next event will be stored and sets \a available to the number of events
+    which can be written there contiguously. The written events have to be added to the queue using \l{commit()}. */
+GpioEvent *GpioEventQueue::writeBuffer(int *available)
+{
+    int index = static_cast<int>(m_writeIndex.loadAcquire() & m_mask);
+    *available = qMin(freeSpace(), capacity() - index);
+    return m_data + index;
+}
+
+/*! Adds \a count events written to the \l{writeBuffer()} to the queue. */
+void GpioEventQueue::commit(int count)
+{
+    m_writeIndex.storeRelease(m_writeIndex.loadAcquire() + static_cast<quint32>(qMin(count, freeSpace())));
+}
+
+/*! Returns the queued event at \a index, where index 0 is the oldest event. */
+const GpioEvent &GpioEventQueue::at(int index) const
+{
+    return m_data[(m_readIndex.loadAcquire() + static_cast<quint32>(index)) & m_mask];
+}
@@ -0,0 +1,70 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOEVENTQUEUE_H
+#define GPIOEVENTQUEUE_H
+
+#include <QVector>
+#include <QAtomicInteger>
+
+#include "gpiobackend.h"
+
+class GpioEventQueue
+{
+public:
+    explicit GpioEventQueue(int capacity = 256);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    int count() const;
+    int freeSpace() const;
+    bool isEmpty() const;
+    bool isFull() const;
+    void clear();
+
+    bool enqueue(const GpioEvent &event);
+    int dequeue(GpioEvent *events, int maxEvents);
+
+    GpioEvent *writeBuffer(int *available);
+    void commit(int count);
+
+    const GpioEvent &at(int index) const;
+
+private:
+    QVector<GpioEvent> m_buffer;
+    GpioEvent *m_data = nullptr;
+    quint32 m_mask = 0;
+    QAtomicInteger<quint32> m_readIndex;
+    QAtomicInteger<quint32> m_writeIndex;
+
+};
+
+#endif // GPIOEVENTQUEUE_H
@@ -0,0 +1,216 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioEventRecorder
+    \brief Records the edges of GpioMonitors into a binary log file.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The recorder writes each edge as a record of 16 bytes containing the GPIO number, the value, the timestamp and the sequence
+    number into a memory mapped file. Recording an edge costs a copy into the mapping, the file grows in large steps and the
+    kernel writes the pages back in the background. The log can be played back using \l{GpioEventReplay}.
+
+    The recorder listens to the \l{GpioMonitor::edgeEvent()} signal of the added monitors, which gets emitted in the
+    \l{GpioMonitor::DeliveryModeImmediate}{immediate delivery mode}. Other sources can call \l{record()} directly.
+
+    \code
+        GpioEventRecorder *recorder = new GpioEventRecorder("/tmp/edges.log", this);
+        if (recorder->open()) {
+            recorder->addMonitor(monitor);
+        }
+    \endcode
+
+    The log starts with a header containing the magic \c NGEV, the format version and the number of records, followed by the
+    records. All values are stored in the byte order of the host.
+
+    \sa GpioEventReplay
+*/
+
+#include "gpioeventrecorder.h"
+#include "gpiomonitor.h"
+
+#include <string.h>
+
+static_assert(sizeof(GpioEventLogHeader) == 16, "Unexpected event log header size");
+static_assert(sizeof(GpioEventRecord) == 16, "Unexpected event record size");
+
+// The file grows by this number of records at once
+static const quint64 recordChunk = 65536;
+
+/*! Constructs a GpioEventRecorder writing to the file with the given \a fileName and \a parent. */
+GpioEventRecorder::GpioEventRecorder(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    m_file(fileName)
+{
+
+}
+
+/*! Destroys the GpioEventRecorder and closes the log. */
+GpioEventRecorder::~GpioEventRecorder()
+{
+    close();
+}
+
+/*! Returns the name of the log file. */
+QString GpioEventRecorder::fileName() const
+{
+    return m_file.fileName();
+}
+
+/*! Creates or truncates the log file and maps it into memory. Returns false if the file could not be opened. */
+bool GpioEventRecorder::open()
+{
+    if (isOpen())
+        return true;
+
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qCWarning(dcGpio()) << "GpioEventRecorder: Could not open" << m_file.fileName() << ":" << m_file.errorString();
+        return false;
+    }
+
+    m_count = 0;
+    if (!mapFile(recordChunk)) {
+        m_file.close();
+        return false;
+    }
+
+    GpioEventLogHeader *header = reinterpret_cast<GpioEventLogHeader *>(m_data);
+    memcpy(header->magic, "NGEV", 4);
+    header->version = 1;
+    header->count = 0;
+    return true;
+}
+
+/*! Writes the number of records into the header, truncates the file to the recorded size and closes it. */
+void GpioEventRecorder::close()
+{
+    foreach (const QMetaObject::Connection &connection, m_connections)
+        disconnect(connection);
+
+    m_connections.clear();
+
+    if (!m_file.isOpen())
+        return;
+
+    if (m_data) {
+        reinterpret_cast<GpioEventLogHeader *>(m_data)->count = m_count;
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+
+    m_file.resize(sizeof(GpioEventLogHeader) + m_count * sizeof(GpioEventRecord));
+    m_file.close();
+
+    qCDebug(dcGpio()) << "GpioEventRecorder: Recorded" << m_count << "events into" << m_file.fileName();
+}
+
+/*! Returns true if the log file is open for recording. */
+bool GpioEventRecorder::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+/*! Records the edges emitted by the given \a monitor until the recorder gets closed or the monitor gets removed. */
+void GpioEventRecorder::addMonitor(GpioMonitor *monitor)
+{
+    if (!monitor || m_connections.contains(monitor))
+        return;
+
+    int gpio = monitor->gpioNumber();
+    m_connections.insert(monitor, connect(monitor, &GpioMonitor::edgeEvent, this, [this, gpio](bool value, qint64 timestamp, quint32 sequence){
+        record(gpio, value, timestamp, sequence);
+    }));
+
+    connect(monitor, &GpioMonitor::destroyed, this, [this, monitor](){
+        m_connections.remove(monitor);
+    });
+}
+
+/*! Stops recording the edges of the given \a monitor. */
+void GpioEventRecorder::removeMonitor(GpioMonitor *monitor)
+{
+    if (!m_connections.contains(monitor))
+        return;
+
+    disconnect(m_connections.take(monitor));
+}
+
+/*! Returns the number of records written since the log has been opened. */
+quint64 GpioEventRecorder::recordCount() const
+{
+    return m_count;
+}
+
+/*! Appends an edge of the given \a gpio with the \a value, \a timestamp and \a sequence number to the log. */
+void GpioEventRecorder::record(int gpio, bool value, qint64 timestamp, quint32 sequence)
+{
+    if (!isOpen())
+        return;
+
+    if (m_count == m_capacity && !mapFile(m_capacity + recordChunk)) {
+        qCWarning(dcGpio()) << "GpioEventRecorder: Could not grow" << m_file.fileName() << ", stop recording.";
+        close();
+        return;
+    }
+
+    GpioEventRecord *record = reinterpret_cast<GpioEventRecord *>(m_data + sizeof(GpioEventLogHeader)) + m_count;
+    record->timestamp = timestamp;
+    record->sequence = sequence;
+    record->gpio = static_cast<qint16>(gpio);
+    record->value = value ? 1 : 0;
+    record->reserved = 0;
+    m_count++;
+}
+
+bool GpioEventRecorder::mapFile(quint64 capacity)
+{
+    if (m_data) {
+        // Keep the number of records in the file valid while remapping
+        reinterpret_cast<GpioEventLogHeader *>(m_data)->count = m_count;
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+
+    qint64 size = sizeof(GpioEventLogHeader) + capacity * sizeof(GpioEventRecord);
+    if (!m_file.resize(size)) {
+        qCWarning(dcGpio()) << "GpioEventRecorder: Could not resize" << m_file.fileName() << ":" << m_file.errorString();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data) {
+        qCWarning(dcGpio()) << "GpioEventRecorder: Could not map" << m_file.fileName() << ":" << m_file.errorString();
+        return false;
+    }
+
+    m_capacity = capacity;
+    return true;
+}
@@ -0,0 +1,91 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOEVENTRECORDER_H
+#define GPIOEVENTRECORDER_H
+
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QMetaObject>
+
+class GpioMonitor;
+
+// The binary layout of an event log, all values in host byte order
+struct GpioEventLogHeader
+{
+    char magic[4];
+    quint32 version;
+    quint64 count;
+};
+
+struct GpioEventRecord
+{
+    qint64 timestamp;
+    quint32 sequence;
+    qint16 gpio;
+    quint8 value;
+    quint8 reserved;
+};
+
+class GpioEventRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioEventRecorder(const QString &fileName, QObject *parent = nullptr);
+    ~GpioEventRecorder() override;
+
+    QString fileName() const;
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    void addMonitor(GpioMonitor *monitor);
+    void removeMonitor(GpioMonitor *monitor);
+
+    quint64 recordCount() const;
+
+public slots:
+    void record(int gpio, bool value, qint64 timestamp, quint32 sequence);
+
+private:
+    QFile m_file;
+    uchar *m_data = nullptr;
+    quint64 m_capacity = 0;
+    quint64 m_count = 0;
+    QHash<GpioMonitor *, QMetaObject::Connection> m_connections;
+
+    bool mapFile(quint64 capacity);
+
+};
+
+#endif // GPIOEVENTRECORDER_H
@@ -0,0 +1,277 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioEventReplay
+    \brief Plays back an event log recorded by the GpioEventRecorder.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The replay maps the log recorded by a \l{GpioEventRecorder} and feeds the edges into the added \l{GpioMonitor}{GpioMonitors},
+    which deliver them to their consumers according to their \l{GpioMonitor::DeliveryMode}{delivery mode} like edges read
+    from the hardware. Additionally each edge gets emitted using \l{edgeEvent()}. This allows to reproduce the edge stream
+    of a device in the field and to benchmark consumers without any hardware. The monitors should not be enabled while
+    replaying, the edges keep their recorded timestamps and sequence numbers.
+
+    With a \l{speed()} of 1.0 the edges will be replayed with the recorded timing, higher values replay faster. A speed of 0
+    replays the edges as fast as possible, in batches to keep the event loop responsive.
+
+    \code
+        GpioMonitor *monitor = new GpioMonitor(27, this);
+        connect(monitor, &GpioMonitor::valueChanged, this, &Button::stateChanged);
+
+        GpioEventReplay *replay = new GpioEventReplay("/tmp/edges.log", this);
+        replay->setSpeed(0);
+        replay->addMonitor(monitor);
+        connect(replay, &GpioEventReplay::finished, this, [](){ qDebug() << "Replay finished"; });
+        if (replay->open())
+            replay->start();
+    \endcode
+
+    \sa GpioEventRecorder
+*/
+
+/*! \fn void GpioEventReplay::edgeEvent(int gpio, bool value, qint64 timestamp, quint32 sequence);
+    This signal will be emitted for each replayed edge of the given \a gpio with the recorded \a value, \a timestamp and \a sequence.
+*/
+
+/*! \fn void GpioEventReplay::finished();
+    This signal will be emitted once all records have been replayed.
+*/
+
+#include "gpioeventreplay.h"
+#include "gpiomonitor.h"
+#include "gpiorealtime.h"
+
+#include <string.h>
+
+// The number of records replayed per event loop iteration with unlimited speed
+static const int replayBatch = 1024;
+
+/*! Constructs a GpioEventReplay reading the log file with the given \a fileName and \a parent. */
+GpioEventReplay::GpioEventReplay(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    m_file(fileName)
+{
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &GpioEventReplay::onTimeout);
+}
+
+/*! Destroys the GpioEventReplay and closes the log. */
+GpioEventReplay::~GpioEventReplay()
+{
+    close();
+}
+
+/*! Returns the name of the log file. */
+QString GpioEventReplay::fileName() const
+{
+    return m_file.fileName();
+}
+
+/*! Opens and maps the log file. Returns false if the file could not be opened or is not a valid event log. */
+bool GpioEventReplay::open()
+{
+    if (isOpen())
+        return true;
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qCWarning(dcGpio()) << "GpioEventReplay: Could not open" << m_file.fileName() << ":" << m_file.errorString();
+        return false;
+    }
+
+    qint64 size = m_file.size();
+    if (size < static_cast<qint64>(sizeof(GpioEventLogHeader))) {
+        qCWarning(dcGpio()) << "GpioEventReplay:" << m_file.fileName() << "is not an event log.";
+        m_file.close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data) {
+        qCWarning(dcGpio()) << "GpioEventReplay: Could not map" << m_file.fileName() << ":" << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    const GpioEventLogHeader *header = reinterpret_cast<const GpioEventLogHeader *>(m_data);
+    if (memcmp(header->magic, "NGEV", 4) != 0 || header->version != 1) {
+        qCWarning(dcGpio()) << "GpioEventReplay:" << m_file.fileName() << "is not a supported event log.";
+        close();
+        return false;
+    }
+
+    // A log which has not been closed properly contains the records written until the last remapping
+    quint64 available = (size - sizeof(GpioEventLogHeader)) / sizeof(GpioEventRecord);
+    m_count = qMin(header->count, available);
+    m_records = reinterpret_cast<const GpioEventRecord *>(m_data + sizeof(GpioEventLogHeader));
+    m_position = 0;
+    qCDebug(dcGpio()) << "GpioEventReplay: Opened" << m_file.fileName() << "with" << m_count << "records";
+    return true;
+}
+
+/*! Stops the replay and closes the log file. */
+void GpioEventReplay::close()
+{
+    m_timer->stop();
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+
+    m_records = nullptr;
+    m_count = 0;
+    m_position = 0;
+    m_file.close();
+}
+
+/*! Returns true if the log file is open. */
+bool GpioEventReplay::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+/*! Returns the number of records in the log. */
+quint64 GpioEventReplay::recordCount() const
+{
+    return m_count;
+}
+
+/*! Returns the number of records replayed so far. */
+quint64 GpioEventReplay::position() const
+{
+    return m_position;
+}
+
+/*! Returns the replay speed relative to the recorded timing. A speed of 0 means the edges get replayed as fast as possible. */
+double GpioEventReplay::speed() const
+{
+    return m_speed;
+}
+
+/*! Sets the replay \a speed relative to the recorded timing. The default is 1.0, a speed of 0 replays as fast as possible.
+    This has to be set before the replay gets started. */
+void GpioEventReplay::setSpeed(double speed)
+{
+    m_speed = qMax(speed, 0.0);
+}
+
+/*! Feeds the recorded edges of the GPIO of the given \a monitor into the \a monitor. */
+void GpioEventReplay::addMonitor(GpioMonitor *monitor)
+{
+    if (!monitor)
+        return;
+
+    m_monitors.insert(monitor->gpioNumber(), monitor);
+}
+
+/*! Stops feeding edges into the given \a monitor. */
+void GpioEventReplay::removeMonitor(GpioMonitor *monitor)
+{
+    if (!monitor)
+        return;
+
+    m_monitors.remove(monitor->gpioNumber());
+}
+
+/*! Returns true while the replay is running. */
+bool GpioEventReplay::isRunning() const
+{
+    return m_timer->isActive();
+}
+
+/*! Starts replaying the log from the beginning. Returns false if the log is not open. */
+bool GpioEventReplay::start()
+{
+    if (!isOpen()) {
+        qCWarning(dcGpio()) << "GpioEventReplay: Cannot start, the log is not open.";
+        return false;
+    }
+
+    m_position = 0;
+    m_startTime = GpioRealtime::monotonicTime();
+    m_timer->start(0);
+    return true;
+}
+
+/*! Stops the replay. */
+void GpioEventReplay::stop()
+{
+    m_timer->stop();
+}
+
+void GpioEventReplay::replayRecord(const GpioEventRecord &record)
+{
+    GpioEvent event;
+    event.value = (record.value != 0);
+    event.timestamp = record.timestamp;
+    event.sequence = record.sequence;
+
+    emit edgeEvent(record.gpio, event.value, event.timestamp, event.sequence);
+
+    GpioMonitor *monitor = m_monitors.value(record.gpio);
+    if (monitor)
+        monitor->injectEvent(event);
+}
+
+void GpioEventReplay::onTimeout()
+{
+    if (m_speed <= 0) {
+        quint64 end = qMin(m_position + replayBatch, m_count);
+        while (m_position < end && isOpen())
+            replayRecord(m_records[m_position++]);
+    } else {
+        // Replay everything which is due, relative to the first record
+        qint64 elapsed = static_cast<qint64>((GpioRealtime::monotonicTime() - m_startTime) * m_speed);
+        while (m_position < m_count && isOpen() && m_records[m_position].timestamp - m_records[0].timestamp <= elapsed)
+            replayRecord(m_records[m_position++]);
+    }
+
+    // A receiver might have closed the log
+    if (!isOpen())
+        return;
+
+    if (m_position >= m_count) {
+        qCDebug(dcGpio()) << "GpioEventReplay: Replayed" << m_count << "records";
+        emit finished();
+        return;
+    }
+
+    if (m_speed <= 0) {
+        m_timer->start(0);
+        return;
+    }
+
+    qint64 due = static_cast<qint64>((m_records[m_position].timestamp - m_records[0].timestamp) / m_speed);
+    qint64 remaining = due - (GpioRealtime::monotonicTime() - m_startTime);
+    m_timer->start(static_cast<int>(qMax<qint64>(remaining, 0) / 1000000));
+}
@@ -0,0 +1,96 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOEVENTREPLAY_H
+#define GPIOEVENTREPLAY_H
+
+#include <QFile>
+#include <QHash>
+#include <QTimer>
+#include <QObject>
+#include <QPointer>
+
+#include "gpioeventrecorder.h"
+
+class GpioMonitor;
+
+class GpioEventReplay : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioEventReplay(const QString &fileName, QObject *parent = nullptr);
+    ~GpioEventReplay() override;
+
+    QString fileName() const;
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    quint64 recordCount() const;
+    quint64 position() const;
+
+    double speed() const;
+    void setSpeed(double speed);
+
+    void addMonitor(GpioMonitor *monitor);
+    void removeMonitor(GpioMonitor *monitor);
+
+    bool isRunning() const;
+
+public slots:
+    bool start();
+    void stop();
+
+signals:
+    void edgeEvent(int gpio, bool value, qint64 timestamp, quint32 sequence);
+    void finished();
+
+private:
+    QFile m_file;
+    uchar *m_data = nullptr;
+    const GpioEventRecord *m_records = nullptr;
+    quint64 m_count = 0;
+    quint64 m_position = 0;
+    double m_speed = 1.0;
+
+    QTimer *m_timer = nullptr;
+    qint64 m_startTime = 0;
+    QHash<int, QPointer<GpioMonitor> > m_monitors;
+
+    void replayRecord(const GpioEventRecord &record);
+
+private slots:
+    void onTimeout();
+
+};
+
+#endif // GPIOEVENTREPLAY_H
@@ -0,0 +1,445 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioMockBackend
+    \brief An in-memory backend simulating exported GPIOs.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The mock backend behaves like an exported GPIO without accessing any hardware, which allows to run and benchmark
+    \l{Gpio}, \l{GpioMonitor} and \l{GpioButton} based code without root permissions. It gets selected with
+    \l{Gpio::BackendMock} or by setting the environment variable \tt NYMEA_GPIO_BACKEND to \tt mock.
+
+    All backends of the same GPIO number share one simulated pin. The level of an input can be changed using
+    \l{setInputValue()}, which queues an interrupt event according to the configured edge. The events get delivered
+    through a pipe, so the \l{eventFd()} can be watched like the descriptor of a real GPIO. If the pipe is full, the event
+    gets dropped while the sequence number still advances, like the kernel does when its event buffer overflows.
+
+    With \l{startEdgeGenerator()} a thread toggles an input at a given rate, which produces a reproducible edge stream
+    for benchmarks.
+
+    \code
+        qputenv("NYMEA_GPIO_BACKEND", "mock");
+
+        GpioMonitor *monitor = new GpioMonitor(5, this);
+        monitor->enable();
+
+        GpioMockBackend::setInputValue(5, true);
+        GpioMockBackend::startEdgeGenerator(5, 1000);
+    \endcode
+*/
+
+#include "gpiomockbackend.h"
+#include "gpiorealtime.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QAtomicInteger>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+struct MockPin
+{
+    bool exported = false;
+    Gpio::Direction direction = Gpio::DirectionInput;
+    bool level = false;
+    bool activeLow = false;
+    Gpio::Edge edge = Gpio::EdgeNone;
+    quint32 sequence = 0;
+    quint64 generatedEdges = 0;
+    int readFd = -1;
+    int writeFd = -1;
+};
+
+class MockEdgeGenerator : public QThread
+{
+public:
+    MockEdgeGenerator(int gpio, double frequency) :
+        m_gpio(gpio),
+        m_interval(static_cast<qint64>(1000000000.0 / frequency))
+    {
+        setObjectName("gpio-mock");
+    }
+
+    ~MockEdgeGenerator() override
+    {
+        m_running.storeRelease(0);
+        wait();
+    }
+
+    void start()
+    {
+        m_running.storeRelease(1);
+        QThread::start();
+    }
+
+protected:
+    void run() override
+    {
+        bool level = GpioMockBackend::pinValue(m_gpio);
+        qint64 deadline = GpioRealtime::monotonicTime();
+        while (m_running.loadAcquire()) {
+            level = !level;
+            GpioMockBackend::setInputValue(m_gpio, level);
+            deadline += qMax<qint64>(m_interval, 1);
+            GpioRealtime::sleepUntil(deadline);
+        }
+    }
+
+private:
+    int m_gpio;
+    qint64 m_interval;
+    QAtomicInt m_running;
+};
+
+struct MockRegistry
+{
+    QMutex mutex;
+    QHash<int, MockPin> pins;
+    QHash<int, MockEdgeGenerator *> generators;
+
+    ~MockRegistry()
+    {
+        // The generators access the registry, stop them first
+        qDeleteAll(generators);
+        foreach (const MockPin &pin, pins) {
+            if (pin.readFd >= 0) {
+                ::close(pin.readFd);
+                ::close(pin.writeFd);
+            }
+        }
+    }
+};
+
+MockRegistry *registry()
+{
+    static MockRegistry instance;
+    return &instance;
+}
+
+void queueEvent(MockPin &pin)
+{
+    if (!pin.exported || pin.direction != Gpio::DirectionInput || pin.writeFd < 0)
+        return;
+
+    bool value = pin.level != pin.activeLow;
+    if (pin.edge == Gpio::EdgeNone || (pin.edge == Gpio::EdgeRising && !value) || (pin.edge == Gpio::EdgeFalling && value))
+        return;
+
+    GpioEvent event;
+    event.value = value;
+    event.timestamp = GpioRealtime::monotonicTime();
+    event.sequence = ++pin.sequence;
+
+    // A full pipe drops the event, the gap in the sequence numbers reports it
+    if (::write(pin.writeFd, &event, sizeof(event)) < 0 && errno != EAGAIN)
+        qCWarning(dcGpio()) << "GpioMockBackend: Could not queue event:" << strerror(errno);
+}
+
+}
+
+/*! Constructs the mock backend for the given \a gpio number. */
+GpioMockBackend::GpioMockBackend(int gpio) :
+    GpioBackend(gpio)
+{
+
+}
+
+/*! Destroys the backend. The simulated pin keeps its state until it gets unexported. */
+GpioMockBackend::~GpioMockBackend()
+{
+
+}
+
+/*! Returns true, the mock backend is always available. */
+bool GpioMockBackend::isAvailable()
+{
+    return true;
+}
+
+/*! Sets the physical level of the simulated input \a gpio to \a value and queues an interrupt event if the edge matches.
+    Returns false if the pin is configured as output. The level can be set before the pin gets exported. */
+bool GpioMockBackend::setInputValue(int gpio, bool value)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    MockPin &pin = mock->pins[gpio];
+    if (pin.exported && pin.direction == Gpio::DirectionOutput)
+        return false;
+
+    if (pin.level == value)
+        return true;
+
+    pin.level = value;
+    pin.generatedEdges++;
+    queueEvent(pin);
+    return true;
+}
+
+/*! Returns the physical level of the simulated \a gpio, i.e. the value written to an output. */
+bool GpioMockBackend::pinValue(int gpio)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    return mock->pins.value(gpio).level;
+}
+
+/*! Returns true if the simulated \a gpio is exported. */
+bool GpioMockBackend::isExported(int gpio)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    return mock->pins.value(gpio).exported;
+}
+
+/*! Starts a thread toggling the level of the simulated input \a gpio with \a frequency edges per second. Returns false if the
+    \a frequency is not positive. A running generator of the pin will be replaced. */
+bool GpioMockBackend::startEdgeGenerator(int gpio, double frequency)
+{
+    if (frequency <= 0) {
+        qCWarning(dcGpio()) << "GpioMockBackend: Invalid edge generator frequency" << frequency;
+        return false;
+    }
+
+    stopEdgeGenerator(gpio);
+
+    MockEdgeGenerator *generator = new MockEdgeGenerator(gpio, frequency);
+    MockRegistry *mock = registry();
+    mock->mutex.lock();
+    mock->generators.insert(gpio, generator);
+    mock->mutex.unlock();
+
+    generator->start();
+    return true;
+}
+
+/*! Stops the edge generator of the simulated input \a gpio. */
+void GpioMockBackend::stopEdgeGenerator(int gpio)
+{
+    MockRegistry *mock = registry();
+    mock->mutex.lock();
+    MockEdgeGenerator *generator = mock->generators.take(gpio);
+    mock->mutex.unlock();
+
+    // The generator locks the registry while toggling
+    delete generator;
+}
+
+/*! Returns the number of level changes of the simulated input \a gpio, including the events which have been dropped. */
+quint64 GpioMockBackend::generatedEdges(int gpio)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    return mock->pins.value(gpio).generatedEdges;
+}
+
+/*! Returns \l{Gpio::BackendMock}. */
+Gpio::Backend GpioMockBackend::type() const
+{
+    return Gpio::BackendMock;
+}
+
+/*! Exports the simulated pin and creates its event pipe. If the pin is already exported, this function will return true. */
+bool GpioMockBackend::exportGpio()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    MockPin &pin = mock->pins[m_gpio];
+    if (pin.exported)
+        return true;
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        qCWarning(dcGpio()) << "GpioMockBackend: Could not create event pipe for GPIO" << m_gpio << ":" << strerror(errno);
+        return false;
+    }
+
+    pin.readFd = fds[0];
+    pin.writeFd = fds[1];
+    pin.exported = true;
+    return true;
+}
+
+/*! Unexports the simulated pin and closes its event pipe. */
+bool GpioMockBackend::unexportGpio()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    if (!mock->pins.contains(m_gpio))
+        return true;
+
+    MockPin &pin = mock->pins[m_gpio];
+    if (pin.readFd >= 0) {
+        ::close(pin.readFd);
+        ::close(pin.writeFd);
+    }
+
+    pin.readFd = -1;
+    pin.writeFd = -1;
+    pin.exported = false;
+    pin.direction = Gpio::DirectionInput;
+    pin.activeLow = false;
+    pin.edge = Gpio::EdgeNone;
+    return true;
+}
+
+/*! Sets the \a direction of the simulated pin. */
+bool GpioMockBackend::setDirection(Gpio::Direction direction)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    MockPin &pin = mock->pins[m_gpio];
+    if (!pin.exported)
+        return false;
+
+    pin.direction = direction;
+    if (direction == Gpio::DirectionOutput)
+        pin.edge = Gpio::EdgeNone;
+
+    return true;
+}
+
+/*! Returns the direction of the simulated pin. */
+Gpio::Direction GpioMockBackend::direction()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    const MockPin pin = mock->pins.value(m_gpio);
+    return pin.exported ? pin.direction : Gpio::DirectionInvalid;
+}
+
+/*! Sets the logical \a value of the simulated output. Returns false if the pin is not configured as output. */
+bool GpioMockBackend::setValue(Gpio::Value value)
+{
+    if (value == Gpio::ValueInvalid)
+        return false;
+
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    MockPin &pin = mock->pins[m_gpio];
+    if (!pin.exported || pin.direction != Gpio::DirectionOutput)
+        return false;
+
+    pin.level = (value == Gpio::ValueHigh) != pin.activeLow;
+    return true;
+}
+
+/*! Returns the logical value of the simulated pin. */
+Gpio::Value GpioMockBackend::value()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    const MockPin pin = mock->pins.value(m_gpio);
+    if (!pin.exported)
+        return Gpio::ValueInvalid;
+
+    return (pin.level != pin.activeLow) ? Gpio::ValueHigh : Gpio::ValueLow;
+}
+
+/*! Sets the \a activeLow configuration of the simulated pin. */
+bool GpioMockBackend::setActiveLow(bool activeLow)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    MockPin &pin = mock->pins[m_gpio];
+    if (!pin.exported)
+        return false;
+
+    pin.activeLow = activeLow;
+    return true;
+}
+
+/*! Returns the active low configuration of the simulated pin. */
+bool GpioMockBackend::activeLow()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    return mock->pins.value(m_gpio).activeLow;
+}
+
+/*! Sets the \a edge of the simulated input which queues interrupt events. */
+bool GpioMockBackend::setEdgeInterrupt(Gpio::Edge edge)
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    MockPin &pin = mock->pins[m_gpio];
+    if (!pin.exported || pin.direction != Gpio::DirectionInput)
+        return false;
+
+    pin.edge = edge;
+    return true;
+}
+
+/*! Returns the edge configuration of the simulated pin. */
+Gpio::Edge GpioMockBackend::edgeInterrupt()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    return mock->pins.value(m_gpio).edge;
+}
+
+/*! Returns the read end of the event pipe of the simulated pin, or -1 if the pin is not exported. */
+int GpioMockBackend::eventFd()
+{
+    MockRegistry *mock = registry();
+    QMutexLocker locker(&mock->mutex);
+    return mock->pins.value(m_gpio).readFd;
+}
+
+/*! Returns QSocketNotifier::Read, the event pipe becomes readable once events are queued. */
+QSocketNotifier::Type GpioMockBackend::eventNotifierType() const
+{
+    return QSocketNotifier::Read;
+}
+
+/*! Reads at most \a maxEvents queued events from the event pipe into \a events. Returns the number of events read, or -1 on error. */
+int GpioMockBackend::readEvents(GpioEvent *events, int maxEvents)
+{
+    if (maxEvents <= 0)
+        return 0;
+
+    int fd = eventFd();
+    if (fd < 0)
+        return -1;
+
+    // Each event gets written atomically, the pipe always contains whole events
+    ssize_t size = ::read(fd, events, static_cast<size_t>(maxEvents) * sizeof(GpioEvent));
+    if (size < 0)
+        return (errno == EAGAIN) ? 0 : -1;
+
+    return static_cast<int>(size / static_cast<ssize_t>(sizeof(GpioEvent)));
+}
@@ -0,0 +1,75 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOMOCKBACKEND_H
+#define GPIOMOCKBACKEND_H
+
+#include "gpiobackend.h"
+
+class GpioMockBackend : public GpioBackend
+{
+public:
+    explicit GpioMockBackend(int gpio);
+    ~GpioMockBackend() override;
+
+    static bool isAvailable();
+
+    static bool setInputValue(int gpio, bool value);
+    static bool pinValue(int gpio);
+    static bool isExported(int gpio);
+
+    static bool startEdgeGenerator(int gpio, double frequency);
+    static void stopEdgeGenerator(int gpio);
+    static quint64 generatedEdges(int gpio);
+
+    Gpio::Backend type() const override;
+
+    bool exportGpio() override;
+    bool unexportGpio() override;
+
+    bool setDirection(Gpio::Direction direction) override;
+    Gpio::Direction direction() override;
+
+    bool setValue(Gpio::Value value) override;
+    Gpio::Value value() override;
+
+    bool setActiveLow(bool activeLow) override;
+    bool activeLow() override;
+
+    bool setEdgeInterrupt(Gpio::Edge edge) override;
+    Gpio::Edge edgeInterrupt() override;
+
+    int eventFd() override;
+    QSocketNotifier::Type eventNotifierType() const override;
+    int readEvents(GpioEvent *events, int maxEvents) override;
+
+};
+
+#endif // GPIOMOCKBACKEND_H
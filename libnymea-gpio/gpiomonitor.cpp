@@ -33,8 +33,9 @@
     \brief The GpioMonitor class allows to monitor GPIOs.
     \ingroup hardware
     \inmodule libnymea
-    An instance of this class creates a thread, which monitors each of the added GPIOs. The object
-    emits a signal if one of the added GPIOs changes its value. The GpioMonitor configures a GPIO as an
+    An instance of this class monitors the interrupts of a GPIO. By default the interrupts get handled in the event loop of
+    the thread owning the monitor. Optionally a dedicated real-time thread can wait for the interrupts
+    (\l{setRealtimeThreadEnabled()}). The object emits a signal if the GPIO changes its value. The GpioMonitor configures a GPIO as an
     input, with the edge interrupt EDGE_BOTH (\l{Gpio::setEdgeInterrupt()}{setEdgeInterrupt}).
     \chapter Example
     Following example shows how to use the GpioMonitor class for a button on the Raspberry Pi. There are two possibilitys
@@ -54,7 +55,7 @@
           {
               return m_button->enable();
           }
-          void Button::stateChanged(const bool &value)
+          void Button::stateChanged(bool value)
           {
               if (m_pressed != value) {
                   m_pressed = value;
@@ -66,19 +67,178 @@
               }
           }
     \endcode
+
+    \chapter Event delivery
+    On each wakeup the monitor drains all pending interrupt events of the \l{Gpio} into a preallocated event queue
+    (\l{eventBufferSize()}). Using the character device backend, the kernel queues edges which arrive faster than the
+    event loop wakes up, they will be read with one \tt read call and none of them gets merged. Edges the kernel could
+    not queue in time are detected using the event sequence numbers and counted in \l{droppedEvents()}.
+
+    In the \l{DeliveryModeImmediate}{immediate delivery mode} the events will be emitted in order using \l{valueChanged()}
+    and \l{edgeEvent()}. In the \l{DeliveryModeQueued}{queued delivery mode} the events stay in the queue and the
+    \l{eventsQueued()} signal will be emitted once per wakeup. The consumer takes the events using \l{takeEvents()}.
+    If the queue is full, the monitor stops reading until events have been taken, leaving further events in the kernel buffer.
+
+    The monitor counts the edges it read, the dropped edges and the read errors, and records the latency from the
+    timestamp of each edge to its delivery (the emission of \l{edgeEvent()} or \l{takeEvents()}) in a histogram.
+    The counters are always enabled and can be read using \l{statistics()}.
+
+    \chapter Direct callbacks
+    The event path of the monitor does not allocate memory: the events will be read using the raw descriptor of the
+    \l{Gpio} into the preallocated event queue and the signals only carry values. Receivers which do not want to go
+    through the signal machinery can register a plain function using \l{addEdgeCallback()}, which will be called for
+    each event in the \l{DeliveryModeImmediate}{immediate delivery mode} before the signals get emitted.
+
+    \code
+        static void onEdge(void *context, const GpioEvent &event)
+        {
+            static_cast<Controller *>(context)->handleEdge(event.value, event.timestamp);
+        }
+
+        monitor->addEdgeCallback(&onEdge, controller);
+    \endcode
+
+    Functors and lambdas can be subscribed using \l{subscribe()}. They are stored in the same fixed slots without any
+    allocation, the type erasure costs the same function pointer call as a plain callback.
+
+    \chapter Real-time thread
+    If the event loop of the owner thread is busy, every interrupt gets delayed. With \l{setRealtimeThreadEnabled()} the monitor
+    waits for the interrupts in a dedicated thread, which can run with a \tt SCHED_FIFO \l{setRealtimePriority()}{priority} on a
+    given \l{setCpuAffinity()}{CPU}. The thread reads the events into the lock-free single producer, single consumer event queue
+    and wakes up the owner thread using an \tt eventfd. The signals will still be emitted in the owner thread, but the event
+    timestamps and the reading of the kernel buffer do not depend on the load of the owner thread any more.
+
+    \chapter Sampling fallback
+    Some GPIOs, for example the pins of many I2C port expanders, do not support edge interrupts. By default \l{enable()}
+    fails for them. If a \l{setPollInterval()}{poll interval} has been set and the edge interrupt can not be configured,
+    the monitor samples the value every \l{pollInterval()} in the owner thread instead and delivers the changes like
+    edges (\l{isPolling()}). The value file stays open for the sampling, so each sample costs one system call and wakes
+    up the owner thread. Changes shorter than one interval might be missed. For many of these GPIOs, a \l{GpioScanner}
+    samples all of them with one call per chip.
+
+    \chapter Debouncing
+    With \l{setDebounceInterval()} the monitor debounces the input. Using the character device backend, the debouncing will
+    be requested from the kernel (\tt GPIO_V2_LINE_ATTR_ID_DEBOUNCE), which absorbs bouncing edges in the GPIO controller or
+    the kernel and never wakes up the process for them. If the kernel does not support debouncing the line, as well as using
+    the sysfs backend, the monitor debounces the events when reading them: the first edge gets delivered immediately
+    and further edges within the interval get absorbed. If the input settled to a different value at the end of the interval,
+    the last absorbed edge will be delivered. Absorbed edges never reach the event queue.
+
+    \chapter Counter mode
+    Pulse outputs like S0 interfaces of energy or water meters can produce edges faster than it makes sense to handle
+    each of them with a signal. In the \l{DeliveryModeCounter}{counter mode} the monitor only counts the edges while
+    reading them (\l{count()}) and emits \l{countChanged()} at most once per \l{countInterval()} with the number of new
+    edges. The \l{frequency()} will be calculated over the \l{frequencyWindow()}. Usually the GPIO should be enabled with
+    Gpio::EdgeRising or Gpio::EdgeFalling in this mode, so each pulse gets counted once. Once no edges have been counted
+    for a whole \l{frequencyWindow()}, the monitor stops waking up until the next edge.
+
+    \code
+        GpioMonitor *meter = new GpioMonitor(22, this);
+        meter->setDeliveryMode(GpioMonitor::DeliveryModeCounter);
+        meter->setDebounceInterval(5);
+        connect(meter, &GpioMonitor::countChanged, this, [this, meter](quint64 delta){
+            qDebug() << delta << "new pulses, total" << meter->count() << "at" << meter->frequency() << "Hz";
+        });
+        meter->enable(false, Gpio::EdgeRising);
+    \endcode
+
+    \chapter Coalesced mode
+    Consumers like user interfaces or cloud synchronization only need the latest state of an input, while a chattering
+    input can produce thousands of edges per second. In the \l{DeliveryModeCoalesced}{coalesced mode} the monitor reads
+    and counts the edges like in the counter mode and delivers at most one value per \l{coalesceInterval()}: at the end
+    of each interval with edges, \l{valueCoalesced()} reports the latest value together with the number of edges which
+    have been suppressed in the interval, and \l{valueChanged()} will be emitted if the value is different from the last
+    delivered one. The latest value wins, the delivery might be delayed by up to one interval. Intervals without edges do
+    not wake up the monitor.
+*/
+
+/*!
+    \enum GpioMonitor::DeliveryMode
+    This enum type specifies how interrupt events will be delivered.
+
+    \value DeliveryModeImmediate
+        Each event will be emitted using \l{valueChanged()} and \l{edgeEvent()}.
+    \value DeliveryModeQueued
+        The events will be kept in the event queue and \l{eventsQueued()} will be emitted once per wakeup.
+    \value DeliveryModeCounter
+        The events will only be counted, \l{countChanged()} will be emitted periodically.
+    \value DeliveryModeCoalesced
+        The events will be counted, the latest value will be emitted using \l{valueCoalesced()} and \l{valueChanged()}
+        at most once per \l{coalesceInterval()}.
+*/
+
+/*!
+    \variable GpioMonitor::maxEdgeCallbacks
+    The number of slots shared by the direct callbacks and the subscribers of a monitor.
+*/
+
+/*!
+    \variable GpioMonitor::subscriberStorageSize
+    The size in bytes of the inline storage of a subscriber.
 */
 
-/*! \fn void GpioMonitor::valueChanged(const bool &value);
+/*! \fn void GpioMonitor::eventsQueued(int count);
+ *  This signal will be emitted in the \l{DeliveryModeQueued}{queued delivery mode} whenever new events have been queued.
+ *  The \a count is the total number of events waiting in the queue. \sa takeEvents() */
+
+/*! \fn void GpioMonitor::countChanged(quint64 delta);
+ *  This signal will be emitted in the \l{DeliveryModeCounter}{counter mode} at most once per \l{countInterval()}
+ *  if new edges have been counted. The \a delta is the number of edges counted since the last emission. \sa count() */
+
+/*! \fn void GpioMonitor::valueCoalesced(bool value, quint64 suppressedEdges);
+ *  This signal will be emitted in the \l{DeliveryModeCoalesced}{coalesced mode} at the end of each \l{coalesceInterval()}
+ *  with edges. The \a value is the value after the latest edge, \a suppressedEdges the number of edges of the interval
+ *  which are not represented by a change of the delivered value. \sa suppressedEdges() */
+
+/*! \fn void GpioMonitor::valueChanged(bool value);
  *  This signal will be emitted, if the monitored \l{Gpio}{Gpios} changed his \a value. */
 
+/*! \fn void GpioMonitor::edgeEvent(bool value, qint64 timestamp, quint32 sequence);
+ *  This signal will be emitted for each interrupt of the monitored \l{Gpio} together with \l{valueChanged()}.
+ *  The \a timestamp is given in nanoseconds of \tt CLOCK_MONOTONIC. Using the character device backend, the
+ *  \a timestamp is taken by the kernel when the edge occurred and the \a sequence is the kernel line event
+ *  sequence number, which makes the event independent of the event loop latency. Using the sysfs backend, the
+ *  \a timestamp is taken when the \a value has been read and the \a sequence is counted by the monitor. */
+
 #include "gpiomonitor.h"
+#include "gpiobackend.h"
+#include "gpiochipinfo.h"
+#include "gpiomonitorthread.h"
+#include "gpiorealtime.h"
+#include "gpiotrace.h"
+
+#include <QPointer>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 /*! Constructs a \l{GpioMonitor} object with the given \a gpio number and \a parent. */
 GpioMonitor::GpioMonitor(int gpio, QObject *parent) :
     QObject(parent),
     m_gpioNumber(gpio)
 {
-    m_valueFile.setFileName("/sys/class/gpio/gpio" + QString::number(m_gpioNumber) + "/value");
+
+}
+
+/*! Constructs a \l{GpioMonitor} object for the GPIO line with the given \a lineName and \a parent.
+
+    \sa GpioChipInfo::gpioNumber()
+*/
+GpioMonitor::GpioMonitor(const QString &lineName, QObject *parent) :
+    GpioMonitor(GpioChipInfo::gpioNumber(lineName), parent)
+{
+
+}
+
+/*! Destroys this \l{GpioMonitor} and stops the monitoring. */
+GpioMonitor::~GpioMonitor()
+{
+    disable();
+
+    for (int i = 0; i < maxEdgeCallbacks; i++)
+        releaseEdgeCallback(m_edgeCallbacks[i]);
 }
 
 /*! Returns true if this \l{GpioMonitor} could be enabled successfully. With the \a activeLow parameter the values can be inverted.
@@ -88,23 +248,93 @@ bool GpioMonitor::enable(bool activeLow, Gpio::Edge edgeInterrupt)
     if (!Gpio::isAvailable())
         return false;
 
+    resetStatistics();
     m_gpio = new Gpio(m_gpioNumber, this);
+    m_gpio->backend()->setEventBufferSize(m_eventQueue.capacity());
     if (!m_gpio->exportGpio() ||
             !m_gpio->setDirection(Gpio::DirectionInput) ||
-            !m_gpio->setActiveLow(activeLow) ||
-            !m_gpio->setEdgeInterrupt(edgeInterrupt)) {
+            !m_gpio->setActiveLow(activeLow)) {
         qCWarning(dcGpio()) << "GpioMonitor: Error while initializing GPIO" << m_gpio->gpioNumber();
         return false;
     }
 
-    if (!m_valueFile.open(QFile::ReadOnly)) {
-        qWarning(dcGpio()) << "GpioMonitor: Could not open value file for gpio monitor" << m_gpio->gpioNumber();
+    // Lines without interrupt support will be sampled instead
+    bool interruptSupported = m_gpio->setEdgeInterrupt(edgeInterrupt);
+    if (!interruptSupported && m_pollInterval <= 0) {
+        qCWarning(dcGpio()) << "GpioMonitor: Error while initializing GPIO" << m_gpio->gpioNumber() << ". Set a poll interval to sample GPIOs without interrupt support.";
         return false;
     }
 
-    m_notifier = new QSocketNotifier(m_valueFile.handle(), QSocketNotifier::Exception);
+    GpioBackend *backend = m_gpio->backend();
+    m_kernelDebounce = false;
+    m_softwareDebounce = false;
+    if (m_debounceInterval > 0) {
+        m_kernelDebounce = backend->setDebounce(m_debounceInterval * 1000);
+        m_softwareDebounce = !m_kernelDebounce;
+        qCDebug(dcGpio()) << "GpioMonitor: Debounce GPIO" << m_gpioNumber << "with" << m_debounceInterval << "ms" << (m_kernelDebounce ? "in the kernel" : "in software");
+    }
+
+    int eventFd = interruptSupported ? backend->eventFd() : -1;
+    if (eventFd < 0 && m_pollInterval <= 0) {
+        qWarning(dcGpio()) << "GpioMonitor: Could not set up the interrupt for gpio monitor" << m_gpio->gpioNumber();
+        return false;
+    }
+
+    m_currentValue = (m_gpio->value() == Gpio::ValueHigh);
+    m_sequence = 0;
+    m_droppedEvents.storeRelease(0);
+    m_queueFull = false;
+    m_eventQueue.clear();
+    m_debounceTimestamp = 0;
+    m_debounceValue = m_currentValue;
+    m_debouncePending = false;
+    m_count.storeRelease(0);
+    m_countValue.storeRelease(m_currentValue ? 1 : 0);
+    m_reportedCount = 0;
+    m_countSampleIndex = 0;
+    m_countSampleCount = 0;
+    m_suppressedEdges = 0;
+
+    createCountTimer();
+
+    if (eventFd < 0) {
+        startPolling(edgeInterrupt);
+        return true;
+    }
+
+    if (m_realtimeThreadEnabled) {
+        m_notifyFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_notifyFd < 0) {
+            qCWarning(dcGpio()) << "GpioMonitor: Could not create the notification of the monitor thread:" << strerror(errno);
+            return false;
+        }
+
+        m_notifier = new QSocketNotifier(m_notifyFd, QSocketNotifier::Read);
+        connect(m_notifier, &QSocketNotifier::activated, this, &GpioMonitor::onThreadNotification);
+
+        m_thread = new GpioMonitorThread(this, eventFd, backend->eventNotifierType(), m_notifyFd);
+        m_thread->setRealtimePriority(m_realtimePriority);
+        m_thread->setCpuAffinity(m_cpuAffinity);
+        if (!m_thread->start()) {
+            disable();
+            return false;
+        }
+
+        qCDebug(dcGpio()) << "Monitor thread started";
+        return true;
+    }
+
+    m_notifier = new QSocketNotifier(eventFd, backend->eventNotifierType());
     connect(m_notifier, &QSocketNotifier::activated, this, &GpioMonitor::readyReady);
 
+    if (m_softwareDebounce) {
+        // Checks the value once the input settled
+        m_debounceTimer = new QTimer(this);
+        m_debounceTimer->setSingleShot(true);
+        m_debounceTimer->setTimerType(Qt::PreciseTimer);
+        connect(m_debounceTimer, &QTimer::timeout, this, &GpioMonitor::onDebounceTimeout);
+    }
+
     qCDebug(dcGpio()) << "Socket notififier started";
     m_notifier->setEnabled(true);
     return true;
@@ -113,22 +343,37 @@ bool GpioMonitor::enable(bool activeLow, Gpio::Edge edgeInterrupt)
 /*! Disables this \l{GpioMonitor}. */
 void GpioMonitor::disable()
 {
+    // Stop the thread before the gpio and the queue go away
+    delete m_thread;
     delete m_notifier;
+    delete m_debounceTimer;
+    delete m_countTimer;
+    delete m_pollTimer;
     delete m_gpio;
 
+    m_thread = nullptr;
+    m_pollTimer = nullptr;
     m_notifier = 0;
+    m_debounceTimer = nullptr;
+    m_countTimer = nullptr;
     m_gpio = 0;
 
-    m_valueFile.close();
+    if (m_notifyFd >= 0) {
+        ::close(m_notifyFd);
+        m_notifyFd = -1;
+    }
 }
 
 /*! Returns true if this \l{GpioMonitor} is running. */
 bool GpioMonitor::isRunning() const
 {
+    if (m_pollTimer)
+        return m_pollTimer->isActive();
+
     if (!m_notifier)
         return false;
 
-    return m_notifier->isEnabled();
+    return m_notifier->isEnabled() || m_queueFull;
 }
 
 /*! Returns the current value of this \l{GpioMonitor}. */
@@ -137,28 +382,885 @@ bool GpioMonitor::value() const
     return m_currentValue;
 }
 
+/*! Returns true if the monitored GPIO has no interrupt support and gets sampled every \l{pollInterval()}. */
+bool GpioMonitor::isPolling() const
+{
+    return m_pollTimer != nullptr;
+}
+
+/*! Returns the sample interval in milliseconds used for GPIOs without interrupt support. The default is 0, the sampling fallback is disabled. */
+int GpioMonitor::pollInterval() const
+{
+    return m_pollInterval;
+}
+
+/*! Enables the sampling fallback for GPIOs without interrupt support with a sample interval of \a pollInterval milliseconds.
+    A \a pollInterval of 0 disables the sampling, \l{enable()} fails for such GPIOs then. The interval will be applied on
+    the next \l{enable()}.
+
+    \sa isPolling()
+*/
+void GpioMonitor::setPollInterval(int pollInterval)
+{
+    m_pollInterval = qMax(pollInterval, 0);
+}
+
+/*! Returns the number of the GPIO monitored by this \l{GpioMonitor}. */
+int GpioMonitor::gpioNumber() const
+{
+    return m_gpioNumber;
+}
+
 /*! Returns the \l{Gpio} of this \l{GpioMonitor}. */
 Gpio *GpioMonitor::gpio()
 {
     return m_gpio;
 }
 
-void GpioMonitor::readyReady(const int &ready)
+/*! Returns the delivery mode of this \l{GpioMonitor}. The default is \l{DeliveryModeImmediate}. */
+GpioMonitor::DeliveryMode GpioMonitor::deliveryMode() const
+{
+    return m_deliveryMode;
+}
+
+/*! Sets the delivery mode of this \l{GpioMonitor} to \a deliveryMode. Switching to the \l{DeliveryModeImmediate}{immediate delivery mode}
+    emits all events still waiting in the queue. */
+void GpioMonitor::setDeliveryMode(GpioMonitor::DeliveryMode deliveryMode)
+{
+    m_deliveryMode = deliveryMode;
+    m_counting.storeRelease(isCounting() ? 1 : 0);
+    updateCountTimer();
+
+    if (isCounting() && m_queueFull && m_notifier) {
+        // Counting does not need space in the queue
+        m_queueFull = false;
+        m_notifier->setEnabled(true);
+    }
+
+    if (m_deliveryMode == GpioMonitor::DeliveryModeImmediate) {
+        deliverEvents();
+    }
+}
+
+/*! Returns the number of events the event queue can hold. */
+int GpioMonitor::eventBufferSize() const
+{
+    return m_eventQueue.capacity();
+}
+
+/*! Sets the size of the event queue to \a eventBufferSize events. The size will be rounded up to the next power of two and
+    will also be requested for the kernel event buffer of the character device backend. This has to be set before the
+    monitor gets enabled, queued events will be discarded. */
+void GpioMonitor::setEventBufferSize(int eventBufferSize)
+{
+    m_eventQueue.setCapacity(eventBufferSize);
+}
+
+/*! Returns the number of events waiting in the event queue. */
+int GpioMonitor::queuedEvents() const
+{
+    return m_eventQueue.count();
+}
+
+/*! Moves at most \a maxEvents of the oldest queued events into \a events and returns the number of events taken.
+    Events are only queued in the \l{DeliveryModeQueued}{queued delivery mode}. */
+int GpioMonitor::takeEvents(GpioEvent *events, int maxEvents)
+{
+    int count = m_eventQueue.dequeue(events, maxEvents);
+    for (int i = 0; i < count; i++)
+        recordLatency(events[i]);
+
+    if (count > 0 && m_queueFull && m_notifier) {
+        // There is space again, continue reading the events queued by the kernel
+        m_queueFull = false;
+        m_notifier->setEnabled(true);
+    }
+
+    return count;
+}
+
+/*! Returns the number of events which got lost because the kernel event buffer was full. This requires the event sequence
+    numbers of the character device backend. */
+quint64 GpioMonitor::droppedEvents() const
+{
+    return m_droppedEvents.loadAcquire();
+}
+
+/*! Returns true if this \l{GpioMonitor} waits for interrupts in a dedicated thread. */
+bool GpioMonitor::realtimeThreadEnabled() const
+{
+    return m_realtimeThreadEnabled;
+}
+
+/*! Enables or disables the dedicated monitor thread depending on \a realtimeThreadEnabled. This has to be set before the
+    monitor gets enabled.
+
+    \sa setRealtimePriority(), setCpuAffinity()
+*/
+void GpioMonitor::setRealtimeThreadEnabled(bool realtimeThreadEnabled)
+{
+    m_realtimeThreadEnabled = realtimeThreadEnabled;
+}
+
+/*! Returns the \tt SCHED_FIFO priority of the monitor thread. A priority of 0 means the thread uses the default scheduling policy. */
+int GpioMonitor::realtimePriority() const
+{
+    return m_realtimePriority;
+}
+
+/*! Sets the \tt SCHED_FIFO priority of the monitor thread to \a realtimePriority (1 - 99). A priority of 0 keeps the default
+    scheduling policy. This has to be set before the monitor gets enabled. */
+void GpioMonitor::setRealtimePriority(int realtimePriority)
+{
+    m_realtimePriority = realtimePriority;
+}
+
+/*! Returns the CPU the monitor thread will be bound to, or -1 if the affinity will not be changed. */
+int GpioMonitor::cpuAffinity() const
+{
+    return m_cpuAffinity;
+}
+
+/*! Binds the monitor thread to the CPU \a cpuAffinity. A value of -1 does not change the affinity. This has to be set
+    before the monitor gets enabled. */
+void GpioMonitor::setCpuAffinity(int cpuAffinity)
+{
+    m_cpuAffinity = cpuAffinity;
+}
+
+/*! Returns the debounce interval in milliseconds. A value of 0 means the input will not be debounced, which is the default. */
+int GpioMonitor::debounceInterval() const
+{
+    return m_debounceInterval;
+}
+
+/*! Sets the debounce interval to \a debounceInterval milliseconds. Edges following a delivered edge within this interval will
+    be absorbed, preferably by the kernel. This has to be set before the monitor gets enabled.
+
+    \sa kernelDebounce()
+*/
+void GpioMonitor::setDebounceInterval(int debounceInterval)
+{
+    m_debounceInterval = qMax(debounceInterval, 0);
+}
+
+/*! Returns true if the kernel debounces the input of the running monitor. If a \l{setDebounceInterval()}{debounce interval}
+    has been set and this returns false, the monitor debounces the events in software. */
+bool GpioMonitor::kernelDebounce() const
+{
+    return m_kernelDebounce;
+}
+
+/*! Returns the number of edges counted in the \l{DeliveryModeCounter}{counter mode} since the monitor has been enabled
+    or the count has been reset. */
+quint64 GpioMonitor::count() const
+{
+    return m_count.loadAcquire();
+}
+
+/*! Resets the \l{count()} and the \l{frequency()} measurement. */
+void GpioMonitor::resetCount()
+{
+    m_count.fetchAndStoreOrdered(0);
+    m_reportedCount = 0;
+    m_countSampleIndex = 0;
+    m_countSampleCount = 0;
+}
+
+/*! Returns the frequency of the counted edges in Hz, averaged over the \l{frequencyWindow()}. The frequency will be updated
+    every \l{countInterval()}, it is 0 until two intervals have passed. */
+double GpioMonitor::frequency() const
+{
+    if (m_countSampleCount < 2)
+        return 0;
+
+    int size = m_countSamples.count();
+    const CountSample &newest = m_countSamples.at((m_countSampleIndex + size - 1) % size);
+    const CountSample &oldest = m_countSamples.at((m_countSampleIndex + size - m_countSampleCount) % size);
+    if (newest.timestamp <= oldest.timestamp)
+        return 0;
+
+    return static_cast<double>(newest.count - oldest.count) * 1000000000.0 / (newest.timestamp - oldest.timestamp);
+}
+
+/*! Returns the interval in milliseconds \l{countChanged()} gets emitted at most. The default is 1000 ms. */
+int GpioMonitor::countInterval() const
+{
+    return m_countInterval;
+}
+
+/*! Sets the interval \l{countChanged()} gets emitted at most to \a countInterval milliseconds. */
+void GpioMonitor::setCountInterval(int countInterval)
+{
+    m_countInterval = qMax(countInterval, 1);
+    updateCountTimer();
+}
+
+/*! Returns the window in milliseconds the \l{frequency()} gets averaged over. The default is 10000 ms. */
+int GpioMonitor::frequencyWindow() const
+{
+    return m_frequencyWindow;
+}
+
+/*! Sets the window the \l{frequency()} gets averaged over to \a frequencyWindow milliseconds. The window will be rounded
+    to a multiple of the \l{countInterval()}. */
+void GpioMonitor::setFrequencyWindow(int frequencyWindow)
+{
+    m_frequencyWindow = qMax(frequencyWindow, 1);
+    updateCountTimer();
+}
+
+/*! Returns the interval in milliseconds values get delivered at most in the \l{DeliveryModeCoalesced}{coalesced mode}.
+    The default is 100 ms. */
+int GpioMonitor::coalesceInterval() const
+{
+    return m_coalesceInterval;
+}
+
+/*! Sets the interval values get delivered at most in the \l{DeliveryModeCoalesced}{coalesced mode} to \a coalesceInterval
+    milliseconds. */
+void GpioMonitor::setCoalesceInterval(int coalesceInterval)
+{
+    m_coalesceInterval = qMax(coalesceInterval, 1);
+    updateCountTimer();
+}
+
+/*! Returns the number of edges which have been suppressed in the \l{DeliveryModeCoalesced}{coalesced mode} since the
+    monitor has been enabled. \sa valueCoalesced() */
+quint64 GpioMonitor::suppressedEdges() const
+{
+    return m_suppressedEdges;
+}
+
+/*! Returns a snapshot of the statistics of this \l{GpioMonitor}, including the access counters of the monitored \l{Gpio}.
+    The counters will be reset once the monitor gets enabled.
+
+    \sa GpioStatistics, resetStatistics()
+*/
+GpioStatistics GpioMonitor::statistics() const
+{
+    GpioStatistics statistics;
+    if (m_gpio)
+        statistics = m_gpio->statistics();
+
+    statistics.gpio = m_gpioNumber;
+    statistics.errors += m_readErrors.loadAcquire();
+    statistics.edges = m_edges.loadAcquire();
+    statistics.droppedEdges = m_droppedEvents.loadAcquire();
+    for (int i = 0; i < GpioStatistics::latencyBucketCount; i++)
+        statistics.latencyHistogram[i] = m_latencyHistogram[i].loadAcquire();
+
+    statistics.maxLatency = m_maxLatency.loadAcquire();
+    return statistics;
+}
+
+/*! Resets the edge and latency statistics of this \l{GpioMonitor} and the counters of the monitored \l{Gpio}.
+    The \l{droppedEvents()} will not be reset.
+
+    \sa statistics()
+*/
+void GpioMonitor::resetStatistics()
+{
+    if (m_gpio)
+        m_gpio->resetStatistics();
+
+    m_edges.storeRelease(0);
+    m_readErrors.storeRelease(0);
+    for (int i = 0; i < GpioStatistics::latencyBucketCount; i++)
+        m_latencyHistogram[i].storeRelease(0);
+
+    m_maxLatency.storeRelease(0);
+}
+
+/*! Registers the \a callback, which will be called with the given \a context for each event delivered in the
+    \l{DeliveryModeImmediate}{immediate delivery mode}, right before \l{valueChanged()} and \l{edgeEvent()} get emitted.
+    At most \l{maxEdgeCallbacks} callbacks can be registered, returns false if there is no free slot left.
+
+    \sa removeEdgeCallback()
+*/
+bool GpioMonitor::addEdgeCallback(GpioMonitor::EdgeCallback callback, void *context)
+{
+    if (!callback)
+        return false;
+
+    int slot = freeEdgeCallbackSlot();
+    if (slot < 0)
+        return false;
+
+    m_edgeCallbacks[slot].callback = callback;
+    m_edgeCallbacks[slot].context = context;
+    return true;
+}
+
+/*! Unregisters the \a callback previously registered with the given \a context. A callback may unregister itself while
+    being called.
+
+    \sa addEdgeCallback()
+*/
+void GpioMonitor::removeEdgeCallback(GpioMonitor::EdgeCallback callback, void *context)
+{
+    for (int i = 0; i < maxEdgeCallbacks; i++) {
+        EdgeCallbackEntry &entry = m_edgeCallbacks[i];
+        if (!entry.destroy && entry.callback == callback && entry.context == context) {
+            entry.callback = nullptr;
+            entry.context = nullptr;
+        }
+    }
+}
+
+/*! \fn template<typename Callable> int GpioMonitor::subscribe(Callable callable);
+    Subscribes the \a callable to the events of this monitor and returns the subscription, or -1 if all \l{maxEdgeCallbacks}
+    slots are in use. The \a callable will be invoked with a \c{const GpioEvent &} for each event delivered in the
+    \l{DeliveryModeImmediate}{immediate delivery mode}, right before \l{valueChanged()} and \l{edgeEvent()} get emitted.
+
+    The \a callable will be moved into the inline storage of the slot, which holds up to \l{subscriberStorageSize} bytes,
+    typically a lambda capturing up to three pointers. Larger callables will be rejected at compile time. No memory will
+    be allocated and invoking a subscriber costs one indirect call.
+
+    A subscriber may disable or destroy the monitor while being invoked. The remaining subscribers and signals will not be
+    invoked for that event in this case.
+
+    \code
+        monitor->subscribe([this](const GpioEvent &event) {
+            m_pulses += event.value ? 1 : 0;
+        });
+    \endcode
+
+    \sa unsubscribe(), addEdgeCallback()
+*/
+
+/*! Removes the given \a subscription returned by \l{subscribe()} and destroys its callable. A subscriber may unsubscribe
+    itself while being invoked, the callable will be destroyed once the event has been delivered. */
+void GpioMonitor::unsubscribe(int subscription)
+{
+    if (subscription < 0 || subscription >= maxEdgeCallbacks)
+        return;
+
+    EdgeCallbackEntry &entry = m_edgeCallbacks[subscription];
+    if (!entry.destroy)
+        return;
+
+    entry.callback = nullptr;
+    if (!m_invokingEdgeCallbacks)
+        releaseEdgeCallback(entry);
+}
+
+int GpioMonitor::freeEdgeCallbackSlot() const
+{
+    for (int i = 0; i < maxEdgeCallbacks; i++) {
+        if (!m_edgeCallbacks[i].callback && !m_edgeCallbacks[i].destroy)
+            return i;
+    }
+
+    qCWarning(dcGpio()) << "GpioMonitor: Could not register edge callback for GPIO" << m_gpioNumber << ", all" << maxEdgeCallbacks << "slots in use.";
+    return -1;
+}
+
+void GpioMonitor::releaseEdgeCallback(GpioMonitor::EdgeCallbackEntry &entry)
+{
+    if (entry.destroy)
+        entry.destroy(entry.storage);
+
+    entry.callback = nullptr;
+    entry.context = nullptr;
+    entry.destroy = nullptr;
+}
+
+int GpioMonitor::readEvents()
+{
+    if (m_counting.loadAcquire())
+        return countEvents();
+
+    int queued = 0;
+    GpioBackend *backend = m_gpio->backend();
+    while (true) {
+        int available = 0;
+        GpioEvent *buffer = m_eventQueue.writeBuffer(&available);
+        if (available == 0)
+            break;
+
+        int count = backend->readEvents(buffer, available);
+        if (count <= 0) {
+            if (count < 0)
+                m_readErrors.fetchAndAddRelaxed(1);
+
+            break;
+        }
+
+        m_edges.fetchAndAddRelaxed(count);
+        for (int i = 0; i < count; i++)
+            GPIO_TRACE(GpioTrace::PointEdge, m_gpioNumber, buffer[i].value);
+
+        updateSequence(buffer, count);
+        int accepted = m_softwareDebounce ? debounceEvents(buffer, count) : count;
+
+        // The sysfs interface has no sequence numbers, count the events
+        for (int i = 0; i < accepted; i++) {
+            if (buffer[i].sequence == 0)
+                buffer[i].sequence = ++m_sequence;
+        }
+
+        m_eventQueue.commit(accepted);
+        queued += accepted;
+
+        // A partial read means the kernel has no more events, reading the current value again would duplicate the edge
+        if (count < available || !backend->queuesEvents())
+            break;
+    }
+
+    return queued;
+}
+
+int GpioMonitor::countEvents()
+{
+    GpioBackend *backend = m_gpio->backend();
+    GpioEvent events[64];
+    bool wake = false;
+    while (true) {
+        int count = backend->readEvents(events, 64);
+        if (count <= 0) {
+            if (count < 0)
+                m_readErrors.fetchAndAddRelaxed(1);
+
+            break;
+        }
+
+        m_edges.fetchAndAddRelaxed(count);
+        for (int i = 0; i < count; i++)
+            GPIO_TRACE(GpioTrace::PointEdge, m_gpioNumber, events[i].value);
+
+        updateSequence(events, count);
+        int accepted = m_softwareDebounce ? debounceEvents(events, count) : count;
+        if (accepted > 0 && countEdges(static_cast<quint64>(accepted), events[accepted - 1].value))
+            wake = true;
+
+        if (count < 64 || !backend->queuesEvents())
+            break;
+    }
+
+    // Nothing to deliver, the owner only has to wake up for starting the idle count timer
+    return wake ? 1 : 0;
+}
+
+void GpioMonitor::updateSequence(const GpioEvent *events, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const GpioEvent &event = events[i];
+        if (event.sequence == 0)
+            continue;
+
+        if (m_sequence != 0 && event.sequence > m_sequence + 1)
+            m_droppedEvents.fetchAndAddRelaxed(event.sequence - m_sequence - 1);
+
+        m_sequence = event.sequence;
+    }
+}
+
+void GpioMonitor::createCountTimer()
+{
+    if (!m_countTimer) {
+        m_countTimer = new QTimer(this);
+        connect(m_countTimer, &QTimer::timeout, this, &GpioMonitor::onCountTimeout);
+    }
+
+    updateCountTimer();
+}
+
+void GpioMonitor::updateCountTimer()
+{
+    if (!m_countTimer)
+        return;
+
+    if (!isCounting()) {
+        m_countTimer->stop();
+        return;
+    }
+
+    if (m_deliveryMode == GpioMonitor::DeliveryModeCounter) {
+        // One sample per interval, plus the sample at the start of the window
+        int samples = qMax(m_frequencyWindow / m_countInterval, 1) + 1;
+        if (m_countSamples.count() != samples) {
+            m_countSamples = QVector<CountSample>(samples);
+            m_countSampleIndex = 0;
+            m_countSampleCount = 0;
+        }
+    }
+
+    // A stopped timer waits for the next counted edge
+    if (!m_countTimer->isActive()) {
+        idleCountTimer();
+        return;
+    }
+
+    m_countTimer->start(m_deliveryMode == GpioMonitor::DeliveryModeCoalesced ? m_coalesceInterval : m_countInterval);
+}
+
+// Called once the producer of the counted edges cleared the idle flag
+void GpioMonitor::startCountTimer()
+{
+    if (!m_countTimer || !isCounting() || m_countTimer->isActive())
+        return;
+
+    if (m_deliveryMode == GpioMonitor::DeliveryModeCoalesced) {
+        m_countTimer->start(m_coalesceInterval);
+        return;
+    }
+
+    // No edges have been counted since the last sample, continue the window from now on
+    CountSample &sample = m_countSamples[0];
+    sample.timestamp = GpioRealtime::monotonicTime();
+    sample.count = m_reportedCount;
+    m_countSampleIndex = 1 % m_countSamples.count();
+    m_countSampleCount = 1;
+    m_countTimer->start(m_countInterval);
+}
+
+void GpioMonitor::idleCountTimer()
+{
+    m_countTimer->stop();
+    m_countTimerIdle.storeRelease(1);
+
+    // An edge counted right before the flag has been set did not wake the owner
+    if (m_count.loadAcquire() != m_reportedCount && m_countTimerIdle.testAndSetOrdered(1, 0))
+        startCountTimer();
+}
+
+void GpioMonitor::wakeCountTimer()
+{
+    if (m_countTimer && !m_countTimer->isActive() && !m_countTimerIdle.loadAcquire())
+        startCountTimer();
+}
+
+// Returns true if the count timer is idle and the owner has to start it
+bool GpioMonitor::countEdges(quint64 edges, bool value)
+{
+    m_count.fetchAndAddRelease(edges);
+    m_countValue.storeRelease(value ? 1 : 0);
+    return m_countTimerIdle.testAndSetOrdered(1, 0);
+}
+
+int GpioMonitor::debounceEvents(GpioEvent *events, int count)
+{
+    qint64 interval = static_cast<qint64>(m_debounceInterval) * 1000000;
+    int accepted = 0;
+    for (int i = 0; i < count; i++) {
+        if (m_debounceTimestamp != 0 && events[i].timestamp - m_debounceTimestamp < interval) {
+            // Bouncing, remember the latest edge for the check at the end of the interval
+            m_debounceEvent = events[i];
+            m_debouncePending = true;
+            continue;
+        }
+
+        m_debounceTimestamp = events[i].timestamp;
+        m_debounceValue = events[i].value;
+        m_debouncePending = false;
+        events[accepted++] = events[i];
+    }
+
+    return accepted;
+}
+
+qint64 GpioMonitor::debounceDeadline() const
+{
+    if (!m_debouncePending)
+        return 0;
+
+    return m_debounceTimestamp + static_cast<qint64>(m_debounceInterval) * 1000000;
+}
+
+bool GpioMonitor::checkDebounce()
+{
+    if (!m_debouncePending || GpioRealtime::monotonicTime() < debounceDeadline())
+        return false;
+
+    // The input settled, deliver the last absorbed edge if the value is different now
+    if (m_debounceEvent.value == m_debounceValue) {
+        m_debouncePending = false;
+        return false;
+    }
+
+    if (m_counting.loadAcquire()) {
+        m_debouncePending = false;
+        m_debounceTimestamp = m_debounceEvent.timestamp;
+        m_debounceValue = m_debounceEvent.value;
+        return countEdges(1, m_debounceValue);
+    }
+
+    int available = 0;
+    GpioEvent *buffer = m_eventQueue.writeBuffer(&available);
+    if (available == 0)
+        return false;
+
+    m_debouncePending = false;
+    m_debounceTimestamp = m_debounceEvent.timestamp;
+    m_debounceValue = m_debounceEvent.value;
+    buffer[0] = m_debounceEvent;
+    if (buffer[0].sequence == 0)
+        buffer[0].sequence = ++m_sequence;
+
+    m_eventQueue.commit(1);
+    return true;
+}
+
+void GpioMonitor::deliverEvents()
+{
+    // Only deliver what is queued right now, the monitor thread might keep producing
+    int pending = m_eventQueue.count();
+    while (pending-- > 0) {
+        GpioEvent event;
+        m_eventQueue.dequeue(&event, 1);
+
+        m_currentValue = event.value;
+        recordLatency(event);
+
+        // A subscriber or receiver might have disabled or destroyed the monitor
+        QPointer<GpioMonitor> guard(this);
+        if (!invokeEdgeCallbacks(event) || !m_gpio)
+            return;
+
+        emit valueChanged(event.value);
+        if (!guard || !m_gpio)
+            return;
+
+        emit edgeEvent(event.value, event.timestamp, event.sequence);
+        if (!guard || !m_gpio)
+            return;
+    }
+}
+
+void GpioMonitor::injectEvent(const GpioEvent &event)
+{
+    QPointer<GpioMonitor> guard(this);
+    switch (m_deliveryMode) {
+    case GpioMonitor::DeliveryModeImmediate:
+        m_currentValue = event.value;
+        if (!invokeEdgeCallbacks(event))
+            break;
+
+        // A receiver might have destroyed the monitor
+        emit valueChanged(event.value);
+        if (!guard)
+            break;
+
+        emit edgeEvent(event.value, event.timestamp, event.sequence);
+        break;
+    case GpioMonitor::DeliveryModeQueued:
+        if (!m_eventQueue.enqueue(event)) {
+            m_droppedEvents.fetchAndAddRelaxed(1);
+            break;
+        }
+
+        m_currentValue = event.value;
+        emit eventsQueued(m_eventQueue.count());
+        break;
+    case GpioMonitor::DeliveryModeCounter:
+    case GpioMonitor::DeliveryModeCoalesced:
+        // The count will be reported periodically, also if the monitor is not enabled
+        if (!m_countTimer)
+            createCountTimer();
+
+        if (countEdges(1, event.value))
+            startCountTimer();
+
+        break;
+    }
+}
+
+void GpioMonitor::publishEvents()
+{
+    if (isCounting())
+        return;
+
+    if (m_deliveryMode == GpioMonitor::DeliveryModeImmediate) {
+        deliverEvents();
+        return;
+    }
+
+    if (m_eventQueue.isEmpty())
+        return;
+
+    if (m_eventQueue.isFull()) {
+        // Leave further events in the kernel buffer until the consumer took some
+        m_queueFull = true;
+        m_notifier->setEnabled(false);
+    }
+
+    m_currentValue = m_eventQueue.at(m_eventQueue.count() - 1).value;
+    emit eventsQueued(m_eventQueue.count());
+}
+
+void GpioMonitor::recordLatency(const GpioEvent &event)
+{
+    // Only the consumer records latencies, no compare and swap required
+    qint64 latency = GpioRealtime::monotonicTime() - event.timestamp;
+    m_latencyHistogram[GpioStatistics::latencyBucket(latency)].fetchAndAddRelaxed(1);
+    if (latency > m_maxLatency.loadAcquire())
+        m_maxLatency.storeRelease(latency);
+}
+
+// Returns false if a callback destroyed the monitor, nothing of it may be accessed any more in that case
+bool GpioMonitor::invokeEdgeCallbacks(const GpioEvent &event)
+{
+    QPointer<GpioMonitor> guard(this);
+    m_invokingEdgeCallbacks = true;
+    for (int i = 0; i < maxEdgeCallbacks; i++) {
+        if (m_edgeCallbacks[i].callback) {
+            m_edgeCallbacks[i].callback(m_edgeCallbacks[i].context, event);
+            if (!guard)
+                return false;
+        }
+    }
+
+    m_invokingEdgeCallbacks = false;
+
+    // Destroy the subscribers which unsubscribed while being invoked
+    for (int i = 0; i < maxEdgeCallbacks; i++) {
+        if (!m_edgeCallbacks[i].callback && m_edgeCallbacks[i].destroy)
+            releaseEdgeCallback(m_edgeCallbacks[i]);
+    }
+
+    return true;
+}
+
+void GpioMonitor::startPolling(Gpio::Edge edgeInterrupt)
+{
+    qCInfo(dcGpio()) << "GpioMonitor: GPIO" << m_gpioNumber << "has no interrupt support, sampling every" << m_pollInterval << "ms";
+
+    // Sampling reads the value over and over again, keep the value file open
+    m_gpio->setPersistentValueFile(true);
+    m_pollEdge = edgeInterrupt;
+    m_pollValue = m_currentValue;
+
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_pollTimer, &QTimer::timeout, this, &GpioMonitor::onPollTimeout);
+    m_pollTimer->start(m_pollInterval);
+}
+
+void GpioMonitor::onPollTimeout()
+{
+    Gpio::Value sample = m_gpio->value();
+    if (sample == Gpio::ValueInvalid)
+        return;
+
+    bool value = (sample == Gpio::ValueHigh);
+    if (value == m_pollValue)
+        return;
+
+    m_pollValue = value;
+    if (m_pollEdge == Gpio::EdgeNone ||
+            (m_pollEdge == Gpio::EdgeRising && !value) ||
+            (m_pollEdge == Gpio::EdgeFalling && value)) {
+        return;
+    }
+
+    GpioEvent event;
+    event.value = value;
+    event.timestamp = GpioRealtime::monotonicTime();
+    event.sequence = ++m_sequence;
+    m_edges.fetchAndAddRelaxed(1);
+    GPIO_TRACE(GpioTrace::PointEdge, m_gpioNumber, value);
+    injectEvent(event);
+}
+
+void GpioMonitor::readyReady(int ready)
 {
     Q_UNUSED(ready)
 
-    m_valueFile.seek(0);
-    QByteArray data = m_valueFile.readAll();
+    readEvents();
+    wakeCountTimer();
+
+    if (m_debounceTimer && m_debouncePending) {
+        qint64 remaining = debounceDeadline() - GpioRealtime::monotonicTime();
+        m_debounceTimer->start(static_cast<int>(qMax<qint64>(remaining, 0) / 1000000) + 1);
+    }
+
+    publishEvents();
+}
+
+void GpioMonitor::onDebounceTimeout()
+{
+    if (!checkDebounce() && m_debouncePending) {
+        // The queue is full, check again once the consumer made some space
+        m_debounceTimer->start(1);
+        return;
+    }
+
+    wakeCountTimer();
+    publishEvents();
+}
+
+void GpioMonitor::onThreadNotification()
+{
+    quint64 notifications = 0;
+    if (::read(m_notifyFd, &notifications, sizeof(notifications)) < 0 && errno != EAGAIN)
+        qCWarning(dcGpio()) << "GpioMonitor: Could not read the notification of the monitor thread:" << strerror(errno);
+
+    wakeCountTimer();
+    if (m_deliveryMode == GpioMonitor::DeliveryModeImmediate) {
+        deliverEvents();
+        return;
+    }
+
+    if (m_eventQueue.isEmpty())
+        return;
 
-    bool value = false;
-    if (data[0] == '1') {
-        value = true;
-    } else if (data[0] == '0') {
-        value = false;
-    } else {
+    m_currentValue = m_eventQueue.at(m_eventQueue.count() - 1).value;
+    emit eventsQueued(m_eventQueue.count());
+}
+
+bool GpioMonitor::isCounting() const
+{
+    return m_deliveryMode == GpioMonitor::DeliveryModeCounter || m_deliveryMode == GpioMonitor::DeliveryModeCoalesced;
+}
+
+void GpioMonitor::onCountTimeout()
+{
+    if (m_deliveryMode == GpioMonitor::DeliveryModeCoalesced) {
+        coalesceEvents();
         return;
     }
 
+    quint64 count = m_count.loadAcquire();
+    m_currentValue = m_countValue.loadAcquire();
+
+    CountSample &sample = m_countSamples[m_countSampleIndex];
+    sample.timestamp = GpioRealtime::monotonicTime();
+    sample.count = count;
+    m_countSampleIndex = (m_countSampleIndex + 1) % m_countSamples.count();
+    m_countSampleCount = qMin(m_countSampleCount + 1, m_countSamples.count());
+
+    quint64 delta = count - m_reportedCount;
+    m_reportedCount = count;
+    if (delta > 0) {
+        emit countChanged(delta);
+        return;
+    }
+
+    // Once the whole window is free of edges, the frequency stays 0 until the next edge
+    const CountSample &oldest = m_countSamples.at((m_countSampleIndex + m_countSamples.count() - m_countSampleCount) % m_countSamples.count());
+    if (m_countSampleCount == m_countSamples.count() && oldest.count == count)
+        idleCountTimer();
+}
+
+void GpioMonitor::coalesceEvents()
+{
+    quint64 count = m_count.loadAcquire();
+    quint64 edges = count - m_reportedCount;
+    m_reportedCount = count;
+    if (edges == 0) {
+        idleCountTimer();
+        return;
+    }
+
+    // Latest value wins, one edge is represented by the delivered value if it changed
+    bool value = m_countValue.loadAcquire();
+    bool changed = (value != m_currentValue);
+    quint64 suppressed = changed ? edges - 1 : edges;
+    m_suppressedEdges += suppressed;
     m_currentValue = value;
-    emit valueChanged(value);
+
+    emit valueCoalesced(value, suppressed);
+    if (changed)
+        emit valueChanged(value);
 }
@@ -30,19 +30,41 @@
 #ifndef GPIOMONITOR_H
 #define GPIOMONITOR_H
 
+#include <QTimer>
 #include <QObject>
 #include <QDebug>
+#include <QVector>
 #include <QSocketNotifier>
-#include <QFile>
+#include <QAtomicInteger>
+
+#include <new>
+#include <utility>
 
 #include "gpio.h"
+#include "gpioeventqueue.h"
+
+class GpioMonitorThread;
 
 class GpioMonitor : public QObject
 {
     Q_OBJECT
 
 public:
+    enum DeliveryMode {
+        DeliveryModeImmediate,
+        DeliveryModeQueued,
+        DeliveryModeCounter,
+        DeliveryModeCoalesced
+    };
+    Q_ENUM(DeliveryMode)
+
+    typedef void (*EdgeCallback)(void *context, const GpioEvent &event);
+    static const int maxEdgeCallbacks = 8;
+    static const int subscriberStorageSize = 3 * sizeof(void *);
+
     explicit GpioMonitor(int gpio, QObject *parent = nullptr);
+    explicit GpioMonitor(const QString &lineName, QObject *parent = nullptr);
+    ~GpioMonitor();
 
     bool enable(bool activeLow = false, Gpio::Edge edgeInterrupt = Gpio::EdgeBoth);
     void disable();
@@ -50,21 +72,211 @@ public:
     bool isRunning() const;
     bool value() const;
 
+    int gpioNumber() const;
     Gpio* gpio();
 
+    bool isPolling() const;
+    int pollInterval() const;
+    void setPollInterval(int pollInterval);
+
+    GpioMonitor::DeliveryMode deliveryMode() const;
+    void setDeliveryMode(GpioMonitor::DeliveryMode deliveryMode);
+
+    int eventBufferSize() const;
+    void setEventBufferSize(int eventBufferSize);
+
+    int queuedEvents() const;
+    int takeEvents(GpioEvent *events, int maxEvents);
+
+    quint64 droppedEvents() const;
+
+    bool realtimeThreadEnabled() const;
+    void setRealtimeThreadEnabled(bool realtimeThreadEnabled);
+
+    int realtimePriority() const;
+    void setRealtimePriority(int realtimePriority);
+
+    int cpuAffinity() const;
+    void setCpuAffinity(int cpuAffinity);
+
+    int debounceInterval() const;
+    void setDebounceInterval(int debounceInterval);
+    bool kernelDebounce() const;
+
+    quint64 count() const;
+    void resetCount();
+    double frequency() const;
+
+    int countInterval() const;
+    void setCountInterval(int countInterval);
+
+    int frequencyWindow() const;
+    void setFrequencyWindow(int frequencyWindow);
+
+    int coalesceInterval() const;
+    void setCoalesceInterval(int coalesceInterval);
+    quint64 suppressedEdges() const;
+
+    GpioStatistics statistics() const;
+    void resetStatistics();
+
+    bool addEdgeCallback(GpioMonitor::EdgeCallback callback, void *context);
+    void removeEdgeCallback(GpioMonitor::EdgeCallback callback, void *context);
+
+    template<typename Callable>
+    int subscribe(Callable callable);
+    void unsubscribe(int subscription);
+
 private:
+    friend class GpioMonitorThread;
+    friend class GpioEventReplay;
+
     int m_gpioNumber;
-    Gpio *m_gpio;
-    QSocketNotifier *m_notifier;
-    QFile m_valueFile;
-    bool m_currentValue;
+    Gpio *m_gpio = nullptr;
+    QSocketNotifier *m_notifier = nullptr;
+    bool m_currentValue = false;
+    quint32 m_sequence = 0;
+
+    GpioMonitor::DeliveryMode m_deliveryMode = GpioMonitor::DeliveryModeImmediate;
+    GpioEventQueue m_eventQueue;
+    bool m_queueFull = false;
+    QAtomicInteger<quint64> m_droppedEvents;
+
+    bool m_realtimeThreadEnabled = false;
+    int m_realtimePriority = 0;
+    int m_cpuAffinity = -1;
+    GpioMonitorThread *m_thread = nullptr;
+    int m_notifyFd = -1;
+
+    // Software debounce, only accessed by the thread reading the events
+    int m_debounceInterval = 0;
+    bool m_kernelDebounce = false;
+    bool m_softwareDebounce = false;
+    qint64 m_debounceTimestamp = 0;
+    bool m_debounceValue = false;
+    bool m_debouncePending = false;
+    GpioEvent m_debounceEvent;
+    QTimer *m_debounceTimer = nullptr;
+
+    // Counter mode, the count gets updated by the thread reading the events
+    struct CountSample {
+        qint64 timestamp = 0;
+        quint64 count = 0;
+    };
+
+    QAtomicInt m_counting;
+    QAtomicInteger<quint64> m_count;
+    QAtomicInt m_countValue;
+    quint64 m_reportedCount = 0;
+    int m_countInterval = 1000;
+    int m_frequencyWindow = 10000;
+    QTimer *m_countTimer = nullptr;
+    QAtomicInt m_countTimerIdle;
+    QVector<CountSample> m_countSamples;
+    int m_countSampleIndex = 0;
+    int m_countSampleCount = 0;
+
+    // Sampling of GPIOs without interrupt support
+    int m_pollInterval = 0;
+    QTimer *m_pollTimer = nullptr;
+    Gpio::Edge m_pollEdge = Gpio::EdgeBoth;
+    bool m_pollValue = false;
+
+    // Coalesced mode, uses the count of the counter mode
+    int m_coalesceInterval = 100;
+    quint64 m_suppressedEdges = 0;
+
+    // Statistics, the edges get counted by the thread reading the events, the latencies by the consumer
+    QAtomicInteger<quint64> m_edges;
+    QAtomicInteger<quint64> m_readErrors;
+    QAtomicInteger<quint64> m_latencyHistogram[GpioStatistics::latencyBucketCount];
+    QAtomicInteger<qint64> m_maxLatency;
+
+    // Direct callbacks and subscribers, free slots have neither a callback nor a destructor
+    struct EdgeCallbackEntry {
+        GpioMonitor::EdgeCallback callback = nullptr;
+        void *context = nullptr;
+        void (*destroy)(void *storage) = nullptr;
+        alignas(void *) unsigned char storage[subscriberStorageSize];
+    };
+
+    EdgeCallbackEntry m_edgeCallbacks[maxEdgeCallbacks];
+    bool m_invokingEdgeCallbacks = false;
+
+    int freeEdgeCallbackSlot() const;
+    void releaseEdgeCallback(EdgeCallbackEntry &entry);
+
+    template<typename Callable>
+    static void invokeSubscriber(void *storage, const GpioEvent &event);
+
+    template<typename Callable>
+    static void destroySubscriber(void *storage);
+
+    int readEvents();
+    int countEvents();
+    void updateSequence(const GpioEvent *events, int count);
+    void createCountTimer();
+    void updateCountTimer();
+    void startCountTimer();
+    void idleCountTimer();
+    void wakeCountTimer();
+    bool countEdges(quint64 edges, bool value);
+    bool isCounting() const;
+    void startPolling(Gpio::Edge edgeInterrupt);
+    void coalesceEvents();
+    void injectEvent(const GpioEvent &event);
+    int debounceEvents(GpioEvent *events, int count);
+    qint64 debounceDeadline() const;
+    bool checkDebounce();
+    void deliverEvents();
+    void publishEvents();
+    void recordLatency(const GpioEvent &event);
+    bool invokeEdgeCallbacks(const GpioEvent &event);
 
 signals:
-    void valueChanged(const bool &value);
+    void valueChanged(bool value);
+    void edgeEvent(bool value, qint64 timestamp, quint32 sequence);
+    void eventsQueued(int count);
+    void countChanged(quint64 delta);
+    void valueCoalesced(bool value, quint64 suppressedEdges);
 
 private slots:
-    void readyReady(const int &ready);
+    void readyReady(int ready);
+    void onThreadNotification();
+    void onDebounceTimeout();
+    void onCountTimeout();
+    void onPollTimeout();
 
 };
 
+template<typename Callable>
+int GpioMonitor::subscribe(Callable callable)
+{
+    static_assert(sizeof(Callable) <= subscriberStorageSize, "The callable does not fit into the inline storage of a subscriber, capture a pointer instead.");
+    static_assert(alignof(Callable) <= alignof(void *), "The callable requires a stricter alignment than the inline storage of a subscriber.");
+
+    int slot = freeEdgeCallbackSlot();
+    if (slot < 0)
+        return -1;
+
+    EdgeCallbackEntry &entry = m_edgeCallbacks[slot];
+    new (entry.storage) Callable(std::move(callable));
+    entry.callback = &GpioMonitor::invokeSubscriber<Callable>;
+    entry.context = entry.storage;
+    entry.destroy = &GpioMonitor::destroySubscriber<Callable>;
+    return slot;
+}
+
+template<typename Callable>
+void GpioMonitor::invokeSubscriber(void *storage, const GpioEvent &event)
+{
+    (*static_cast<Callable *>(storage))(event);
+}
+
+template<typename Callable>
+void GpioMonitor::destroySubscriber(void *storage)
+{
+    static_cast<Callable *>(storage)->~Callable();
+}
+
 #endif // GPIOMONITOR_H
@@ -0,0 +1,259 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioMonitorPool
+    \brief Monitors many GPIOs using one epoll instance.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Each \l{GpioMonitor} creates its own \l{Gpio} object and its own QSocketNotifier. For boards with many inputs, the GpioMonitorPool
+    registers the interrupt descriptors of all added GPIOs with one \tt epoll instance, which is watched by a single QSocketNotifier.
+    On wakeup, all ready descriptors will be fetched with one \tt epoll_wait call and dispatched through a compact table.
+
+    The GPIOs get configured like the GpioMonitor does and the \l{valueChanged()} signal has the same semantics as
+    \l{GpioMonitor::valueChanged()}, extended by the number of the GPIO.
+
+    \code
+        GpioMonitorPool *pool = new GpioMonitorPool(this);
+        for (int gpio = 500; gpio < 600; gpio++) {
+            if (!pool->addGpio(gpio)) {
+                qWarning() << "Could not monitor GPIO" << gpio;
+            }
+        }
+
+        connect(pool, &GpioMonitorPool::valueChanged, this, [](int gpio, bool value){
+            qDebug() << "GPIO" << gpio << "changed to" << value;
+        });
+    \endcode
+
+    \sa GpioMonitor
+*/
+
+/*! \fn void GpioMonitorPool::valueChanged(int gpio, bool value);
+    This signal will be emitted, if the monitored \a gpio changed its \a value.
+*/
+
+/*! \fn void GpioMonitorPool::edgeEvent(int gpio, bool value, qint64 timestamp, quint32 sequence);
+    This signal will be emitted for each interrupt of the monitored \a gpio together with \l{valueChanged()}.
+    The \a value, \a timestamp and \a sequence are the same as for \l{GpioMonitor::edgeEvent()}.
+*/
+
+#include "gpiomonitorpool.h"
+#include "gpiobackend.h"
+#include "gpiosysfsbackend.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/*! Constructs an empty GpioMonitorPool with the given \a parent. */
+GpioMonitorPool::GpioMonitorPool(QObject *parent) :
+    QObject(parent)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        qCWarning(dcGpio()) << "GpioMonitorPool: Could not create epoll instance:" << strerror(errno);
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_epollFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &GpioMonitorPool::onActivated);
+}
+
+/*! Destroys the GpioMonitorPool and unexports all monitored GPIOs. */
+GpioMonitorPool::~GpioMonitorPool()
+{
+    foreach (int gpio, m_slots.keys())
+        removeGpio(gpio);
+
+    if (m_epollFd >= 0)
+        ::close(m_epollFd);
+}
+
+/*! Returns true if the given \a gpio could be configured and added to this pool. With the \a activeLow parameter the
+    values can be inverted. With the \a edgeInterrupt parameter the interrupt type can be specified. */
+bool GpioMonitorPool::addGpio(int gpio, bool activeLow, Gpio::Edge edgeInterrupt)
+{
+    if (m_epollFd < 0)
+        return false;
+
+    if (m_slots.contains(gpio)) {
+        qCWarning(dcGpio()) << "GpioMonitorPool: GPIO" << gpio << "is already monitored.";
+        return false;
+    }
+
+    GpioBackend *backend = GpioBackend::create(gpio);
+    bool exported = backend->exportGpio();
+    if (!exported && backend->type() == Gpio::BackendCharacterDevice && GpioSysfsBackend::isAvailable()) {
+        qCDebug(dcGpio()) << "GpioMonitorPool: Falling back to the sysfs backend for GPIO" << gpio;
+        delete backend;
+        backend = GpioBackend::create(gpio, Gpio::BackendSysfs);
+        exported = backend->exportGpio();
+    }
+
+    if (!exported ||
+            !backend->setDirection(Gpio::DirectionInput) ||
+            !backend->setActiveLow(activeLow) ||
+            !backend->setEdgeInterrupt(edgeInterrupt)) {
+        qCWarning(dcGpio()) << "GpioMonitorPool: Error while initializing GPIO" << gpio;
+        backend->unexportGpio();
+        delete backend;
+        return false;
+    }
+
+    int fd = backend->eventFd();
+    if (fd < 0) {
+        qCWarning(dcGpio()) << "GpioMonitorPool: Could not set up the interrupt for GPIO" << gpio;
+        backend->unexportGpio();
+        delete backend;
+        return false;
+    }
+
+    int slot = 0;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+    } else {
+        m_pins.append(Pin());
+        slot = m_pins.count() - 1;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = (backend->eventNotifierType() == QSocketNotifier::Read ? EPOLLIN : EPOLLPRI | EPOLLERR);
+    event.data.u32 = static_cast<uint32_t>(slot);
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        qCWarning(dcGpio()) << "GpioMonitorPool: Could not add GPIO" << gpio << "to the epoll instance:" << strerror(errno);
+        m_freeSlots.append(slot);
+        backend->unexportGpio();
+        delete backend;
+        return false;
+    }
+
+    Pin &pin = m_pins[slot];
+    pin.gpio = gpio;
+    pin.backend = backend;
+    pin.fd = fd;
+    pin.value = (backend->value() == Gpio::ValueHigh);
+    pin.sequence = 0;
+    m_slots.insert(gpio, slot);
+    return true;
+}
+
+/*! Removes the given \a gpio from this pool and unexports it. */
+void GpioMonitorPool::removeGpio(int gpio)
+{
+    if (!m_slots.contains(gpio))
+        return;
+
+    int slot = m_slots.take(gpio);
+    Pin &pin = m_pins[slot];
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, pin.fd, nullptr);
+    pin.backend->unexportGpio();
+    delete pin.backend;
+    pin = Pin();
+    m_freeSlots.append(slot);
+}
+
+/*! Returns the numbers of all monitored GPIOs. */
+QList<int> GpioMonitorPool::gpios() const
+{
+    return m_slots.keys();
+}
+
+/*! Returns true if the given \a gpio is monitored by this pool. */
+bool GpioMonitorPool::contains(int gpio) const
+{
+    return m_slots.contains(gpio);
+}
+
+/*! Returns the number of monitored GPIOs. */
+int GpioMonitorPool::count() const
+{
+    return m_slots.count();
+}
+
+/*! Returns the last known value of the given \a gpio. */
+bool GpioMonitorPool::value(int gpio) const
+{
+    if (!m_slots.contains(gpio))
+        return false;
+
+    return m_pins.at(m_slots.value(gpio)).value;
+}
+
+void GpioMonitorPool::handleEvents(int slot)
+{
+    GpioEvent events[64];
+    GpioBackend *backend = m_pins.at(slot).backend;
+    int count = backend->readEvents(events, 64);
+    for (int i = 0; i < count; i++) {
+        Pin &pin = m_pins[slot];
+        if (pin.backend != backend)
+            return;
+
+        // The sysfs interface has no sequence numbers, count the events
+        if (events[i].sequence == 0) {
+            events[i].sequence = ++pin.sequence;
+        } else {
+            pin.sequence = events[i].sequence;
+        }
+
+        pin.value = events[i].value;
+
+        int gpio = pin.gpio;
+        emit valueChanged(gpio, events[i].value);
+        emit edgeEvent(gpio, events[i].value, events[i].timestamp, events[i].sequence);
+    }
+}
+
+void GpioMonitorPool::onActivated()
+{
+    struct epoll_event events[64];
+    int count = 0;
+    do {
+        count = epoll_wait(m_epollFd, events, 64, 0);
+        if (count < 0) {
+            if (errno != EINTR)
+                qCWarning(dcGpio()) << "GpioMonitorPool: Could not wait for events:" << strerror(errno);
+            return;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int slot = static_cast<int>(events[i].data.u32);
+            // The GPIO might have been removed while handling a previous event
+            if (slot >= m_pins.count() || !m_pins.at(slot).backend)
+                continue;
+
+            handleEvents(slot);
+        }
+    } while (count == 64);
+}
@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOMONITORPOOL_H
+#define GPIOMONITORPOOL_H
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+#include <QSocketNotifier>
+
+#include "gpio.h"
+
+class GpioBackend;
+
+class GpioMonitorPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioMonitorPool(QObject *parent = nullptr);
+    ~GpioMonitorPool();
+
+    bool addGpio(int gpio, bool activeLow = false, Gpio::Edge edgeInterrupt = Gpio::EdgeBoth);
+    void removeGpio(int gpio);
+
+    QList<int> gpios() const;
+    bool contains(int gpio) const;
+    int count() const;
+
+    bool value(int gpio) const;
+
+private:
+    struct Pin {
+        int gpio = -1;
+        GpioBackend *backend = nullptr;
+        int fd = -1;
+        bool value = false;
+        quint32 sequence = 0;
+    };
+
+    int m_epollFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+
+    // The epoll data of each descriptor is the index in this table
+    QVector<Pin> m_pins;
+    QVector<int> m_freeSlots;
+    QHash<int, int> m_slots;
+
+    void handleEvents(int slot);
+
+signals:
+    void valueChanged(int gpio, bool value);
+    void edgeEvent(int gpio, bool value, qint64 timestamp, quint32 sequence);
+
+private slots:
+    void onActivated();
+
+};
+
+#endif // GPIOMONITORPOOL_H
@@ -0,0 +1,171 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioMonitorThread
+    \brief The dedicated thread of a \l{GpioMonitor} in real-time mode.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The thread waits for interrupts of the monitored GPIO using \tt poll and reads the events into the lock-free event
+    queue of the monitor. After each batch of events, the owner thread of the monitor gets woken up using an \tt eventfd.
+    If the monitor debounces in software, the thread also wakes up at the end of the debounce interval.
+
+    \sa GpioMonitor::setRealtimeThreadEnabled()
+*/
+
+#include "gpiomonitorthread.h"
+#include "gpiomonitor.h"
+#include "gpiorealtime.h"
+
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/*! Constructs the thread for \a monitor waiting on \a eventFd for events of the given \a eventType. The owner
+    gets notified by writing to the eventfd \a notifyFd. */
+GpioMonitorThread::GpioMonitorThread(GpioMonitor *monitor, int eventFd, QSocketNotifier::Type eventType, int notifyFd) :
+    QThread(),
+    m_monitor(monitor),
+    m_eventFd(eventFd),
+    m_eventType(eventType),
+    m_notifyFd(notifyFd)
+{
+    setObjectName("gpio-monitor");
+}
+
+/*! Stops and destroys the thread. */
+GpioMonitorThread::~GpioMonitorThread()
+{
+    stop();
+}
+
+/*! Sets the \tt SCHED_FIFO \a priority of the thread. A priority of 0 keeps the default scheduling policy. */
+void GpioMonitorThread::setRealtimePriority(int priority)
+{
+    m_priority = priority;
+}
+
+/*! Binds the thread to the given \a cpu. A value of -1 does not change the affinity. */
+void GpioMonitorThread::setCpuAffinity(int cpu)
+{
+    m_cpu = cpu;
+}
+
+/*! Starts the thread. Returns false if the thread could not be set up. */
+bool GpioMonitorThread::start()
+{
+    if (isRunning())
+        return true;
+
+    m_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_stopFd < 0) {
+        qCWarning(dcGpio()) << "GpioMonitor: Could not create the stop event of the monitor thread:" << strerror(errno);
+        return false;
+    }
+
+    QThread::start();
+    return true;
+}
+
+/*! Stops the thread and waits until it has finished. */
+void GpioMonitorThread::stop()
+{
+    if (m_stopFd < 0)
+        return;
+
+    quint64 stop = 1;
+    if (::write(m_stopFd, &stop, sizeof(stop)) < 0)
+        qCWarning(dcGpio()) << "GpioMonitor: Could not stop the monitor thread:" << strerror(errno);
+
+    wait();
+    ::close(m_stopFd);
+    m_stopFd = -1;
+}
+
+void GpioMonitorThread::run()
+{
+    if (m_priority > 0)
+        GpioRealtime::setCurrentThreadPriority(m_priority);
+
+    if (m_cpu >= 0)
+        GpioRealtime::setCurrentThreadAffinity(m_cpu);
+
+    struct pollfd fds[2];
+    fds[0].fd = m_stopFd;
+    fds[0].events = POLLIN;
+    fds[1].events = (m_eventType == QSocketNotifier::Read ? POLLIN : POLLPRI | POLLERR);
+
+    while (true) {
+        // If the queue is full, leave the events in the kernel and check again shortly
+        bool queueFull = m_monitor->m_eventQueue.isFull();
+        fds[0].revents = 0;
+        fds[1].fd = queueFull ? -1 : m_eventFd;
+        fds[1].revents = 0;
+
+        int timeout = queueFull ? 1 : -1;
+
+        // Wake up at the end of the software debounce interval, a full queue gets checked shortly anyways
+        qint64 deadline = m_monitor->debounceDeadline();
+        if (deadline > 0 && !queueFull) {
+            qint64 remaining = qMax<qint64>(deadline - GpioRealtime::monotonicTime(), 0);
+            timeout = static_cast<int>((remaining + 999999) / 1000000);
+        }
+
+        int result = poll(fds, 2, timeout);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+
+            qCWarning(dcGpio()) << "GpioMonitor: Could not wait for interrupts:" << strerror(errno);
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+            break;
+
+        // In the counter mode nothing gets queued, the owner does not need to wake up
+        bool queued = false;
+        if (fds[1].revents != 0 && m_monitor->readEvents() > 0)
+            queued = true;
+
+        if (m_monitor->checkDebounce())
+            queued = true;
+
+        if (!queued)
+            continue;
+
+        quint64 notification = 1;
+        if (::write(m_notifyFd, &notification, sizeof(notification)) < 0)
+            qCWarning(dcGpio()) << "GpioMonitor: Could not notify the monitor:" << strerror(errno);
+    }
+}
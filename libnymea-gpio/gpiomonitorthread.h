@@ -0,0 +1,66 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOMONITORTHREAD_H
+#define GPIOMONITORTHREAD_H
+
+#include <QThread>
+#include <QSocketNotifier>
+
+class GpioMonitor;
+
+class GpioMonitorThread : public QThread
+{
+public:
+    explicit GpioMonitorThread(GpioMonitor *monitor, int eventFd, QSocketNotifier::Type eventType, int notifyFd);
+    ~GpioMonitorThread() override;
+
+    void setRealtimePriority(int priority);
+    void setCpuAffinity(int cpu);
+
+    bool start();
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    GpioMonitor *m_monitor = nullptr;
+    int m_eventFd = -1;
+    QSocketNotifier::Type m_eventType = QSocketNotifier::Read;
+    int m_notifyFd = -1;
+    int m_stopFd = -1;
+
+    int m_priority = 0;
+    int m_cpu = -1;
+
+};
+
+#endif // GPIOMONITORTHREAD_H
@@ -0,0 +1,360 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioPwm
+    \brief Generates a pulse width modulated signal on a GPIO.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    A GpioPwm drives LEDs, buzzers or motors with a given \l{period()} and \l{dutyCycle()}. If the pin can be driven by a PWM
+    controller of the SoC, the channel of the kernel PWM subsystem can be set using \l{setPwmChannel()}. The signal will then
+    be generated by the hardware using \tt {/sys/class/pwm/pwmchipN/pwmM} and does not cost any CPU time. The pin has to be
+    configured for the PWM function, i.e. using a device tree overlay.
+
+    Without a hardware channel, the signal will be generated in software by a dedicated thread. The thread writes the Gpio using
+    its backend directly and sleeps until absolute deadlines using \tt clock_nanosleep, which keeps the period stable. For a
+    jitter free signal the thread can run with a \l{setRealtimePriority()}{real-time priority} on a dedicated
+    \l{setCpuAffinity()}{CPU}. Software PWM is suitable for periods in the range of milliseconds, i.e. dimming LEDs.
+
+    \code
+        GpioPwm *led = new GpioPwm(18, this);
+        led->setPwmChannel(0, 0);
+        led->setPeriod(1000000);
+        led->setDutyCycle(0.25);
+        if (!led->enable()) {
+            qWarning() << "Could not enable" << led;
+            return;
+        }
+    \endcode
+
+    \sa Gpio
+*/
+
+#include "gpiopwm.h"
+#include "gpiobackend.h"
+#include "gpiopwmthread.h"
+#include "gpiosysfsbackend.h"
+
+#include <QFile>
+#include <QTextStream>
+
+/*! Constructs a GpioPwm for the given \a gpio number with the given \a parent. */
+GpioPwm::GpioPwm(int gpio, QObject *parent) :
+    QObject(parent),
+    m_gpioNumber(gpio)
+{
+
+}
+
+/*! Destroys the GpioPwm and stops the signal. */
+GpioPwm::~GpioPwm()
+{
+    disable();
+}
+
+/*! Returns the number of the Gpio generating the software signal. */
+int GpioPwm::gpioNumber() const
+{
+    return m_gpioNumber;
+}
+
+/*! Returns the number of the PWM chip \tt {/sys/class/pwm/pwmchipN} of the hardware channel, or -1 if none has been set. */
+int GpioPwm::pwmChip() const
+{
+    return m_pwmChip;
+}
+
+/*! Returns the channel of the PWM chip, or -1 if none has been set. */
+int GpioPwm::pwmChannel() const
+{
+    return m_pwmChannel;
+}
+
+/*! Uses the channel \a pwmChannel of the kernel PWM chip \tt {/sys/class/pwm/pwmchipN} with the number \a pwmChip to generate
+    the signal in hardware. If the chip does not exist, the signal will be generated in software. This has to be set before
+    the GpioPwm gets enabled. */
+void GpioPwm::setPwmChannel(int pwmChip, int pwmChannel)
+{
+    m_pwmChip = pwmChip;
+    m_pwmChannel = pwmChannel;
+    m_pwmDirectory = QDir(QString("/sys/class/pwm/pwmchip%1/pwm%2").arg(pwmChip).arg(pwmChannel));
+}
+
+/*! Returns true if the signal is generated by the kernel PWM subsystem. */
+bool GpioPwm::isHardware() const
+{
+    return m_hardware;
+}
+
+/*! Returns true if the signal is being generated. */
+bool GpioPwm::isEnabled() const
+{
+    return m_enabled;
+}
+
+/*! Returns the period of the signal in nanoseconds. The default is 1 ms. */
+qint64 GpioPwm::period() const
+{
+    return m_period;
+}
+
+/*! Sets the \a period of the signal in nanoseconds. Returns false if the hardware did not accept the period. */
+bool GpioPwm::setPeriod(qint64 period)
+{
+    if (period <= 0) {
+        qCWarning(dcGpio()) << "GpioPwm: Invalid period" << period;
+        return false;
+    }
+
+    qint64 previousPeriod = m_period;
+    m_period = period;
+    if (!m_enabled)
+        return true;
+
+    if (m_hardware) {
+        if (!applyHardware(previousPeriod)) {
+            m_period = previousPeriod;
+            return false;
+        }
+
+        return true;
+    }
+
+    m_thread->setTiming(m_period, highTime());
+    return true;
+}
+
+/*! Returns the duty cycle, the share of the period the signal is high, in the range 0.0 to 1.0. */
+double GpioPwm::dutyCycle() const
+{
+    return m_dutyCycle;
+}
+
+/*! Sets the \a dutyCycle in the range 0.0 to 1.0. A duty cycle of 0 keeps the signal low, 1 keeps it high. Returns false if
+    the hardware did not accept the duty cycle. */
+bool GpioPwm::setDutyCycle(double dutyCycle)
+{
+    double previousDutyCycle = m_dutyCycle;
+    m_dutyCycle = qBound(0.0, dutyCycle, 1.0);
+    if (!m_enabled)
+        return true;
+
+    if (m_hardware) {
+        if (!writeHardware("duty_cycle", highTime())) {
+            m_dutyCycle = previousDutyCycle;
+            return false;
+        }
+
+        return true;
+    }
+
+    m_thread->setTiming(m_period, highTime());
+    return true;
+}
+
+/*! Returns the \tt SCHED_FIFO priority of the software PWM thread. A priority of 0 means the thread uses the default scheduling policy. */
+int GpioPwm::realtimePriority() const
+{
+    return m_realtimePriority;
+}
+
+/*! Sets the \tt SCHED_FIFO priority of the software PWM thread to \a realtimePriority (1 - 99). This has to be set before the
+    GpioPwm gets enabled. */
+void GpioPwm::setRealtimePriority(int realtimePriority)
+{
+    m_realtimePriority = realtimePriority;
+}
+
+/*! Returns the CPU the software PWM thread will be bound to, or -1 if the affinity will not be changed. */
+int GpioPwm::cpuAffinity() const
+{
+    return m_cpuAffinity;
+}
+
+/*! Binds the software PWM thread to the CPU \a cpuAffinity. A value of -1 does not change the affinity. This has to be set
+    before the GpioPwm gets enabled. */
+void GpioPwm::setCpuAffinity(int cpuAffinity)
+{
+    m_cpuAffinity = cpuAffinity;
+}
+
+/*! Starts generating the signal. Uses the hardware channel if one has been set and exists, otherwise the Gpio will be exported
+    as output and driven by the software PWM thread. Returns false if the signal could not be started. */
+bool GpioPwm::enable()
+{
+    if (m_enabled)
+        return true;
+
+    if (m_pwmChip >= 0 && QDir(QString("/sys/class/pwm/pwmchip%1").arg(m_pwmChip)).exists()) {
+        if (!enableHardware()) {
+            disableHardware();
+            return false;
+        }
+
+        qCDebug(dcGpio()) << "GpioPwm: Enabled hardware PWM" << this;
+        m_hardware = true;
+        m_enabled = true;
+        return true;
+    }
+
+    if (m_gpioNumber < 0) {
+        qCWarning(dcGpio()) << "GpioPwm: No hardware channel available and no GPIO set for software PWM.";
+        return false;
+    }
+
+    m_gpio = new Gpio(m_gpioNumber, this);
+    m_gpio->setPersistentValueFile(true);
+    if (!m_gpio->exportGpio() || !m_gpio->setDirection(Gpio::DirectionOutput) || !m_gpio->setValue(Gpio::ValueLow)) {
+        qCWarning(dcGpio()) << "GpioPwm: Could not set up GPIO" << m_gpioNumber << "for software PWM.";
+        delete m_gpio;
+        m_gpio = nullptr;
+        return false;
+    }
+
+    // The thread owns the value of the gpio until it gets stopped
+    m_thread = new GpioPwmThread(m_gpio->backend());
+    m_thread->setRealtimePriority(m_realtimePriority);
+    m_thread->setCpuAffinity(m_cpuAffinity);
+    m_thread->setTiming(m_period, highTime());
+    m_thread->start();
+
+    qCDebug(dcGpio()) << "GpioPwm: Enabled software PWM" << this;
+    m_hardware = false;
+    m_enabled = true;
+    return true;
+}
+
+/*! Stops generating the signal, leaves the output low and unexports the Gpio or the hardware channel. */
+void GpioPwm::disable()
+{
+    if (!m_enabled)
+        return;
+
+    if (m_hardware) {
+        disableHardware();
+    } else {
+        delete m_thread;
+        m_thread = nullptr;
+        delete m_gpio;
+        m_gpio = nullptr;
+    }
+
+    m_hardware = false;
+    m_enabled = false;
+}
+
+qint64 GpioPwm::highTime() const
+{
+    return static_cast<qint64>(m_period * m_dutyCycle + 0.5);
+}
+
+bool GpioPwm::enableHardware()
+{
+    if (!m_pwmDirectory.exists()) {
+        QFile exportFile(QString("/sys/class/pwm/pwmchip%1/export").arg(m_pwmChip));
+        if (!exportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            qCWarning(dcGpio()) << "GpioPwm: Could not open PWM export file:" << exportFile.errorString();
+            return false;
+        }
+
+        QTextStream out(&exportFile);
+        out << m_pwmChannel;
+        exportFile.close();
+
+        // Wait until udev adjusted the permissions of the new channel
+        if (!GpioSysfsBackend::waitForWritable(m_pwmDirectory.path(), QStringList() << "period" << "duty_cycle" << "enable", 1000))
+            qCWarning(dcGpio()) << "GpioPwm: The PWM channel" << m_pwmChannel << "did not become accessible after export.";
+    }
+
+    // The duty cycle must never exceed the period, start from a clean state
+    writeHardware("duty_cycle", 0);
+    if (!writeHardware("period", m_period) || !writeHardware("duty_cycle", highTime()))
+        return false;
+
+    return writeHardware("enable", 1);
+}
+
+void GpioPwm::disableHardware()
+{
+    writeHardware("enable", 0);
+
+    QFile unexportFile(QString("/sys/class/pwm/pwmchip%1/unexport").arg(m_pwmChip));
+    if (!unexportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "GpioPwm: Could not open PWM unexport file:" << unexportFile.errorString();
+        return;
+    }
+
+    QTextStream out(&unexportFile);
+    out << m_pwmChannel;
+    unexportFile.close();
+}
+
+bool GpioPwm::writeHardware(const QString &attribute, qint64 value)
+{
+    QFile file(m_pwmDirectory.path() + QDir::separator() + attribute);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "GpioPwm: Could not open" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    // Sysfs reports invalid values when the data gets flushed
+    if (file.write(QByteArray::number(value)) < 0 || !file.flush()) {
+        qCWarning(dcGpio()) << "GpioPwm: Could not write" << value << "to" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    file.close();
+    return true;
+}
+
+bool GpioPwm::applyHardware(qint64 previousPeriod)
+{
+    // Keep the duty cycle below the period at any time
+    if (m_period < previousPeriod) {
+        return writeHardware("duty_cycle", highTime()) && writeHardware("period", m_period);
+    }
+
+    return writeHardware("period", m_period) && writeHardware("duty_cycle", highTime());
+}
+
+/*! Prints the given \a pwm to \a debug. */
+QDebug operator<<(QDebug debug, GpioPwm *pwm)
+{
+    debug.nospace() << "GpioPwm(";
+    if (pwm->isHardware()) {
+        debug.nospace() << "pwmchip" << pwm->pwmChip() << "/pwm" << pwm->pwmChannel() << ", ";
+    } else {
+        debug.nospace() << "gpio " << pwm->gpioNumber() << ", ";
+    }
+
+    debug.nospace() << "period: " << pwm->period() << " ns, duty cycle: " << pwm->dutyCycle() << ")";
+    return debug.space();
+}
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOPWM_H
+#define GPIOPWM_H
+
+#include <QDir>
+#include <QObject>
+
+#include "gpio.h"
+
+class GpioPwmThread;
+
+class GpioPwm : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioPwm(int gpio, QObject *parent = nullptr);
+    ~GpioPwm() override;
+
+    int gpioNumber() const;
+
+    int pwmChip() const;
+    int pwmChannel() const;
+    void setPwmChannel(int pwmChip, int pwmChannel);
+
+    bool isHardware() const;
+    bool isEnabled() const;
+
+    qint64 period() const;
+    bool setPeriod(qint64 period);
+
+    double dutyCycle() const;
+    bool setDutyCycle(double dutyCycle);
+
+    int realtimePriority() const;
+    void setRealtimePriority(int realtimePriority);
+
+    int cpuAffinity() const;
+    void setCpuAffinity(int cpuAffinity);
+
+public slots:
+    bool enable();
+    void disable();
+
+private:
+    int m_gpioNumber = -1;
+    int m_pwmChip = -1;
+    int m_pwmChannel = -1;
+    QDir m_pwmDirectory;
+
+    qint64 m_period = 1000000;
+    double m_dutyCycle = 0;
+    bool m_hardware = false;
+    bool m_enabled = false;
+    int m_realtimePriority = 0;
+    int m_cpuAffinity = -1;
+
+    Gpio *m_gpio = nullptr;
+    GpioPwmThread *m_thread = nullptr;
+
+    qint64 highTime() const;
+
+    bool enableHardware();
+    void disableHardware();
+    bool writeHardware(const QString &attribute, qint64 value);
+    bool applyHardware(qint64 previousPeriod);
+
+};
+
+QDebug operator<< (QDebug debug, GpioPwm *pwm);
+
+#endif // GPIOPWM_H
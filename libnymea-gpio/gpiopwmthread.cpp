@@ -0,0 +1,152 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioPwmThread
+    \brief The thread generating the signal of a software \l{GpioPwm}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The thread writes the value of the GPIO directly using its backend and sleeps until the absolute deadline of the next edge
+    using \tt clock_nanosleep. Since the deadlines are absolute, the wakeup latency does not accumulate and the period stays
+    stable. Values which would not change will not be written, so a duty cycle of 0 or 1 does not cost any writes.
+
+    \sa GpioPwm
+*/
+
+#include "gpiopwmthread.h"
+#include "gpiobackend.h"
+#include "gpiorealtime.h"
+
+/*! Constructs the thread writing the GPIO using the given \a backend. */
+GpioPwmThread::GpioPwmThread(GpioBackend *backend) :
+    QThread(),
+    m_backend(backend)
+{
+    setObjectName("gpio-pwm");
+}
+
+/*! Stops and destroys the thread. */
+GpioPwmThread::~GpioPwmThread()
+{
+    stop();
+}
+
+/*! Sets the \tt SCHED_FIFO \a priority of the thread. A priority of 0 keeps the default scheduling policy. */
+void GpioPwmThread::setRealtimePriority(int priority)
+{
+    m_priority = priority;
+}
+
+/*! Binds the thread to the given \a cpu. A value of -1 does not change the affinity. */
+void GpioPwmThread::setCpuAffinity(int cpu)
+{
+    m_cpu = cpu;
+}
+
+/*! Sets the \a period and the \a highTime of the signal in nanoseconds. The new timing applies from the next period on. */
+void GpioPwmThread::setTiming(qint64 period, qint64 highTime)
+{
+    m_timingSequence.fetchAndAddOrdered(1);
+    m_period.storeRelease(period);
+    m_highTime.storeRelease(highTime);
+    m_timingSequence.fetchAndAddOrdered(1);
+}
+
+/*! Starts generating the signal. */
+void GpioPwmThread::start()
+{
+    if (isRunning())
+        return;
+
+    m_running.storeRelease(1);
+    QThread::start();
+}
+
+/*! Stops generating the signal and waits until the thread has finished. This takes at most one period. */
+void GpioPwmThread::stop()
+{
+    m_running.storeRelease(0);
+    wait();
+}
+
+void GpioPwmThread::run()
+{
+    if (m_priority > 0)
+        GpioRealtime::setCurrentThreadPriority(m_priority);
+
+    if (m_cpu >= 0)
+        GpioRealtime::setCurrentThreadAffinity(m_cpu);
+
+    Gpio::Value value = Gpio::ValueInvalid;
+    qint64 periodStart = GpioRealtime::monotonicTime();
+    while (m_running.loadAcquire()) {
+        qint64 period = 0;
+        qint64 highTime = 0;
+        timing(&period, &highTime);
+        highTime = qBound<qint64>(0, highTime, period);
+
+        if (highTime > 0 && value != Gpio::ValueHigh) {
+            m_backend->setValue(Gpio::ValueHigh);
+            value = Gpio::ValueHigh;
+        }
+
+        if (highTime < period) {
+            if (highTime > 0)
+                GpioRealtime::sleepUntil(periodStart + highTime);
+
+            if (value != Gpio::ValueLow) {
+                m_backend->setValue(Gpio::ValueLow);
+                value = Gpio::ValueLow;
+            }
+        }
+
+        periodStart += period;
+        GpioRealtime::sleepUntil(periodStart);
+
+        // Start over if the thread got delayed by more than a period instead of catching up
+        qint64 now = GpioRealtime::monotonicTime();
+        if (now - periodStart > period)
+            periodStart = now;
+    }
+
+    m_backend->setValue(Gpio::ValueLow);
+}
+
+// Reads the period and the high time of the same setTiming() call
+void GpioPwmThread::timing(qint64 *period, qint64 *highTime) const
+{
+    int sequence = 0;
+    do {
+        sequence = m_timingSequence.loadAcquire();
+        *period = m_period.loadAcquire();
+        *highTime = m_highTime.loadAcquire();
+    } while ((sequence & 1) || m_timingSequence.loadAcquire() != sequence);
+}
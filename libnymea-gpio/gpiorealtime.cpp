@@ -0,0 +1,115 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioRealtime
+    \brief Helper methods for the real-time threads of the library.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The time functions work on nanoseconds of \tt CLOCK_MONOTONIC by default. Deadlines which have to match an external
+    time base, i.e. a clock disciplined using PTP, can be given in \tt CLOCK_REALTIME using \l{GpioRealtime::Clock}.
+
+    Changing the scheduling policy requires the \tt CAP_SYS_NICE capability or an appropriate \tt RLIMIT_RTPRIO limit.
+    If the policy can not be changed, the thread keeps running with the default policy.
+*/
+
+#include "gpiorealtime.h"
+#include "gpio.h"
+
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <pthread.h>
+
+/*! Switches the calling thread to the \tt SCHED_FIFO scheduling policy with the given \a priority (1 - 99).
+    Returns false if the policy could not be changed. */
+bool GpioRealtime::setCurrentThreadPriority(int priority)
+{
+    struct sched_param parameter;
+    memset(&parameter, 0, sizeof(parameter));
+    parameter.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), priority, sched_get_priority_max(SCHED_FIFO));
+
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameter);
+    if (error != 0) {
+        qCWarning(dcGpio()) << "Could not set real-time priority" << parameter.sched_priority << ":" << strerror(error);
+        return false;
+    }
+
+    return true;
+}
+
+/*! Binds the calling thread to the given \a cpu. Returns false if the \a cpu is out of range or the affinity could not be set. */
+bool GpioRealtime::setCurrentThreadAffinity(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        qCWarning(dcGpio()) << "Could not bind thread to CPU" << cpu << ": the CPU is out of range";
+        return false;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (error != 0) {
+        qCWarning(dcGpio()) << "Could not bind thread to CPU" << cpu << ":" << strerror(error);
+        return false;
+    }
+
+    return true;
+}
+
+/*! Returns the current time of \tt CLOCK_MONOTONIC in nanoseconds. This is the clock used for all event timestamps. */
+qint64 GpioRealtime::monotonicTime()
+{
+    return currentTime(GpioRealtime::ClockMonotonic);
+}
+
+/*! Returns the current time of the given \a clock in nanoseconds. */
+qint64 GpioRealtime::currentTime(GpioRealtime::Clock clock)
+{
+    struct timespec now;
+    clock_gettime(clock == GpioRealtime::ClockRealtime ? CLOCK_REALTIME : CLOCK_MONOTONIC, &now);
+    return static_cast<qint64>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+/*! Suspends the calling thread until the given \a clock reached the absolute \a deadline in nanoseconds. Sleeping until an
+    absolute deadline does not accumulate the wakeup latency of consecutive sleeps. If \tt CLOCK_REALTIME gets set while
+    sleeping, the sleep follows the new time. */
+void GpioRealtime::sleepUntil(qint64 deadline, GpioRealtime::Clock clock)
+{
+    struct timespec time;
+    time.tv_sec = static_cast<time_t>(deadline / 1000000000LL);
+    time.tv_nsec = static_cast<long>(deadline % 1000000000LL);
+    clockid_t clockId = clock == GpioRealtime::ClockRealtime ? CLOCK_REALTIME : CLOCK_MONOTONIC;
+    while (clock_nanosleep(clockId, TIMER_ABSTIME, &time, nullptr) == EINTR) { }
+}
@@ -0,0 +1,245 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioScanner
+    \brief Samples a set of GPIOs without interrupt support.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Some GPIOs, for example the pins of many I2C port expanders, do not support edge interrupts, so a \l{GpioMonitor}
+    can not wait for their changes. Polling \l{Gpio::value()} of each pin from a timer costs at least one system call,
+    using the sysfs backend even an open, read and close of the \tt value file per pin and tick.
+
+    The GpioScanner samples up to 64 GPIOs every \l{interval()} using a \l{GpioBank}: using the character device backend,
+    all lines of a chip will be read with one \tt GPIO_V2_LINE_GET_VALUES_IOCTL, using the sysfs backend the \tt value
+    files stay open. Each sample will be compared against the previous one and only the changed GPIOs will be reported
+    using \l{valueChanged()} and \l{edgeEvent()}, like a \l{GpioMonitorPool} does. Changes shorter than one interval
+    might be missed.
+
+    The bit \c n of \l{values()} and \l{valuesChanged()} corresponds to the GPIO at index \c n of the list passed to the
+    constructor.
+
+    \code
+        GpioScanner *scanner = new GpioScanner({496, 497, 498, 499}, this);
+        scanner->setInterval(20);
+        connect(scanner, &GpioScanner::valueChanged, this, [](int gpio, bool value){
+            qDebug() << "GPIO" << gpio << "changed to" << value;
+        });
+
+        if (!scanner->start()) {
+            qWarning() << "Could not start scanning the GPIOs";
+        }
+    \endcode
+
+    \sa GpioMonitor, GpioBank
+*/
+
+/*! \fn void GpioScanner::valueChanged(int gpio, bool value);
+    This signal will be emitted, if a sample of the \a gpio differs from the previous one. The \a value is the new value.
+*/
+
+/*! \fn void GpioScanner::edgeEvent(int gpio, bool value, qint64 timestamp, quint32 sequence);
+    This signal will be emitted for each change of the \a gpio together with \l{valueChanged()}. The \a timestamp is the
+    time of the sample in nanoseconds of \tt CLOCK_MONOTONIC and the \a sequence is counted per GPIO by the scanner.
+*/
+
+/*! \fn void GpioScanner::valuesChanged(quint64 changed, quint64 values);
+    This signal will be emitted once per sample with changes, before the per GPIO signals. The bits set in \a changed
+    mark the GPIOs which changed, \a values contains the new values of all GPIOs.
+*/
+
+#include "gpioscanner.h"
+#include "gpiobank.h"
+#include "gpiorealtime.h"
+
+/*! Constructs a GpioScanner for the given \a gpios numbers with the given \a parent. The backend will be selected automatically. */
+GpioScanner::GpioScanner(const QList<int> &gpios, QObject *parent) :
+    GpioScanner(gpios, Gpio::BackendAuto, parent)
+{
+
+}
+
+/*! Constructs a GpioScanner for the given \a gpios numbers with the given \a parent using the given \a backend. */
+GpioScanner::GpioScanner(const QList<int> &gpios, Gpio::Backend backend, QObject *parent) :
+    QObject(parent)
+{
+    m_bank = new GpioBank(gpios, backend, this);
+    m_gpios = m_bank->gpios();
+    m_sequences = QVector<quint32>(m_gpios.count(), 0);
+
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &GpioScanner::scan);
+}
+
+/*! Destroys the GpioScanner and unexports the GPIOs. */
+GpioScanner::~GpioScanner()
+{
+    stop();
+}
+
+/*! Returns the numbers of the scanned GPIOs. */
+QList<int> GpioScanner::gpios() const
+{
+    return m_gpios;
+}
+
+/*! Returns the sample interval in milliseconds. The default is 10 ms. */
+int GpioScanner::interval() const
+{
+    return m_interval;
+}
+
+/*! Sets the sample interval to \a interval milliseconds. */
+void GpioScanner::setInterval(int interval)
+{
+    m_interval = qMax(interval, 1);
+    if (m_timer->isActive())
+        m_timer->start(m_interval);
+}
+
+/*! Returns true if the values of the GPIOs will be inverted. */
+bool GpioScanner::activeLow() const
+{
+    return m_activeLow;
+}
+
+/*! Inverts the values of the GPIOs if \a activeLow is true. The setting will be applied on the next \l{start()}. */
+void GpioScanner::setActiveLow(bool activeLow)
+{
+    m_activeLow = activeLow;
+}
+
+/*! Exports the GPIOs, configures them as inputs and starts sampling. The first sample will be taken immediately and
+    only initializes \l{values()}. Returns false if the GPIOs could not be configured. */
+bool GpioScanner::start()
+{
+    stop();
+
+    if (m_gpios.isEmpty() || !m_bank->exportGpios() ||
+            !m_bank->setDirection(Gpio::DirectionInput) ||
+            !m_bank->setActiveLow(m_activeLow)) {
+        qCWarning(dcGpio()) << "GpioScanner: Could not configure the GPIOs" << m_gpios;
+        m_bank->unexportGpios();
+        return false;
+    }
+
+    bool ok = false;
+    m_values = m_bank->values(&ok);
+    if (!ok) {
+        qCWarning(dcGpio()) << "GpioScanner: Could not read the initial values of the GPIOs" << m_gpios;
+        m_bank->unexportGpios();
+        return false;
+    }
+
+    m_scans = 0;
+    m_scanFailed = false;
+    m_sequences.fill(0);
+    m_timer->start(m_interval);
+    return true;
+}
+
+/*! Stops sampling and unexports the GPIOs. */
+void GpioScanner::stop()
+{
+    if (!m_timer->isActive())
+        return;
+
+    m_timer->stop();
+    m_bank->unexportGpios();
+}
+
+/*! Returns true if the GPIOs are being sampled. */
+bool GpioScanner::isRunning() const
+{
+    return m_timer->isActive();
+}
+
+/*! Returns the values of the last sample, bit \c n corresponds to the GPIO at index \c n. */
+quint64 GpioScanner::values() const
+{
+    return m_values;
+}
+
+/*! Returns the value of the given \a gpio in the last sample, or false if the \a gpio is not scanned. */
+bool GpioScanner::value(int gpio) const
+{
+    int index = m_gpios.indexOf(gpio);
+    if (index < 0)
+        return false;
+
+    return m_values & (static_cast<quint64>(1) << index);
+}
+
+/*! Returns the number of samples taken since the scanner has been started. */
+quint64 GpioScanner::scans() const
+{
+    return m_scans;
+}
+
+void GpioScanner::scan()
+{
+    bool ok = false;
+    quint64 values = m_bank->values(&ok);
+    if (!ok) {
+        // Keep the last known values, warn only once per failure
+        if (!m_scanFailed)
+            qCWarning(dcGpio()) << "GpioScanner: Could not sample the GPIOs" << m_gpios;
+
+        m_scanFailed = true;
+        return;
+    }
+
+    m_scanFailed = false;
+    m_scans++;
+
+    quint64 changed = values ^ m_values;
+    if (changed == 0)
+        return;
+
+    m_values = values;
+    qint64 timestamp = GpioRealtime::monotonicTime();
+    emit valuesChanged(changed, values);
+
+    while (changed) {
+        int index = __builtin_ctzll(changed);
+        changed &= changed - 1;
+
+        bool value = values & (static_cast<quint64>(1) << index);
+        int gpio = m_gpios.at(index);
+        emit valueChanged(gpio, value);
+        emit edgeEvent(gpio, value, timestamp, ++m_sequences[index]);
+
+        // A receiver might have stopped the scanner
+        if (!m_timer->isActive())
+            return;
+    }
+}
@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOSCANNER_H
+#define GPIOSCANNER_H
+
+#include <QTimer>
+#include <QObject>
+#include <QVector>
+
+#include "gpio.h"
+
+class GpioBank;
+
+class GpioScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioScanner(const QList<int> &gpios, QObject *parent = nullptr);
+    GpioScanner(const QList<int> &gpios, Gpio::Backend backend, QObject *parent = nullptr);
+    ~GpioScanner() override;
+
+    QList<int> gpios() const;
+
+    int interval() const;
+    void setInterval(int interval);
+
+    bool activeLow() const;
+    void setActiveLow(bool activeLow);
+
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    quint64 values() const;
+    bool value(int gpio) const;
+
+    quint64 scans() const;
+
+private:
+    QList<int> m_gpios;
+    GpioBank *m_bank = nullptr;
+    QTimer *m_timer = nullptr;
+    int m_interval = 10;
+    bool m_activeLow = false;
+
+    quint64 m_values = 0;
+    quint64 m_scans = 0;
+    bool m_scanFailed = false;
+    QVector<quint32> m_sequences;
+
+signals:
+    void valueChanged(int gpio, bool value);
+    void edgeEvent(int gpio, bool value, qint64 timestamp, quint32 sequence);
+    void valuesChanged(quint64 changed, quint64 values);
+
+private slots:
+    void scan();
+
+};
+
+#endif // GPIOSCANNER_H
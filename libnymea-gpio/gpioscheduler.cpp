@@ -0,0 +1,237 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioScheduler
+    \brief Writes output values at absolute points in time.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Switching outputs at a given instant, i.e. relays on several boards at the same time using a clock synchronized with
+    PTP, can not be done using a QTimer calling Gpio::setValue(), since the timer depends on the event loop and has a
+    resolution of milliseconds. A GpioScheduler writes each value scheduled using \l{scheduleValue()} from a dedicated
+    thread, which sleeps using \tt clock_nanosleep on the absolute deadline and polls the clock for the last microseconds.
+
+    Deadlines are given in nanoseconds of either \tt CLOCK_MONOTONIC or \tt CLOCK_REALTIME. Once a value has been written,
+    \l{valueApplied()} reports the achieved time relative to the requested one. The skew includes the write of the value,
+    so it is the delay until the output actually changed.
+
+    The Gpio has to be exported and configured as output. Using the sysfs backend, the value file stays open while the
+    scheduler is running. If the Gpio gets destroyed before the scheduler, the scheduler stops and discards all pending values.
+
+    \code
+        Gpio *relay = new Gpio(24, this);
+        relay->exportGpio();
+        relay->setDirection(Gpio::DirectionOutput);
+
+        // Switch on the relay at the full second
+        GpioScheduler *scheduler = new GpioScheduler(relay, this);
+        scheduler->setRealtimePriority(80);
+        connect(scheduler, &GpioScheduler::valueApplied, this, [](int id, bool success, qint64 skew){
+            qDebug() << "Value" << id << "applied" << success << "skew" << skew << "ns";
+        });
+
+        qint64 now = GpioRealtime::currentTime(GpioRealtime::ClockRealtime);
+        qint64 deadline = (now / 1000000000LL + 1) * 1000000000LL;
+        scheduler->scheduleValue(Gpio::ValueHigh, deadline, GpioRealtime::ClockRealtime);
+    \endcode
+
+    \sa Gpio, GpioWaveform, GpioRealtime
+*/
+
+/*! \fn void GpioScheduler::valueApplied(int id, bool success, qint64 skew);
+    This signal will be emitted once the value scheduled with the given \a id has been written. \a success is false if the
+    value could not be written. The \a skew is the time in nanoseconds between the deadline and the end of the write.
+*/
+
+#include "gpioscheduler.h"
+#include "gpioschedulerthread.h"
+
+#include <limits>
+
+/*! Constructs a GpioScheduler writing to the given output \a gpio with the given \a parent. The scheduler does not take the
+    ownership of the \a gpio. */
+GpioScheduler::GpioScheduler(Gpio *gpio, QObject *parent) :
+    QObject(parent),
+    m_gpio(gpio)
+{
+    if (m_gpio)
+        connect(m_gpio.data(), &Gpio::destroyed, this, &GpioScheduler::onGpioDestroyed);
+}
+
+/*! Destroys the GpioScheduler and discards all pending values. */
+GpioScheduler::~GpioScheduler()
+{
+    stop();
+}
+
+/*! Returns the Gpio this scheduler writes to. */
+Gpio *GpioScheduler::gpio() const
+{
+    return m_gpio;
+}
+
+/*! Returns the \tt SCHED_FIFO priority of the scheduler thread. A priority of 0 means the thread uses the default scheduling policy. */
+int GpioScheduler::realtimePriority() const
+{
+    return m_realtimePriority;
+}
+
+/*! Sets the \tt SCHED_FIFO priority of the scheduler thread to \a realtimePriority (1 - 99). This applies once the scheduler
+    gets started the next time. */
+void GpioScheduler::setRealtimePriority(int realtimePriority)
+{
+    m_realtimePriority = realtimePriority;
+}
+
+/*! Returns the CPU the scheduler thread will be bound to, or -1 if the affinity will not be changed. */
+int GpioScheduler::cpuAffinity() const
+{
+    return m_cpuAffinity;
+}
+
+/*! Binds the scheduler thread to the CPU \a cpuAffinity. A value of -1 does not change the affinity. This applies once the
+    scheduler gets started the next time. */
+void GpioScheduler::setCpuAffinity(int cpuAffinity)
+{
+    m_cpuAffinity = cpuAffinity;
+}
+
+/*! Returns true while the scheduler thread is running. */
+bool GpioScheduler::isRunning() const
+{
+    return m_thread != nullptr;
+}
+
+/*! Schedules writing \a value once \a clock reached the absolute \a deadline in nanoseconds. The scheduler will be started if
+    required. Returns the id of the scheduled value, which will be reported by \l{valueApplied()}, or -1 if the value could not
+    be scheduled. A deadline in the past will be written immediately.
+
+    \sa GpioRealtime::currentTime()
+*/
+int GpioScheduler::scheduleValue(Gpio::Value value, qint64 deadline, GpioRealtime::Clock clock)
+{
+    if (value == Gpio::ValueInvalid) {
+        qCWarning(dcGpio()) << "GpioScheduler: Scheduling an invalid value is forbidden.";
+        return -1;
+    }
+
+    if (!m_thread && !start())
+        return -1;
+
+    int id = m_nextId;
+    m_nextId = m_nextId == std::numeric_limits<int>::max() ? 1 : m_nextId + 1;
+    m_thread->schedule(id, value, deadline, clock);
+    return id;
+}
+
+/*! Removes the pending value with the given \a id. Returns false if the value has been written already or is about to be
+    written within the next milliseconds. */
+bool GpioScheduler::cancel(int id)
+{
+    if (!m_thread)
+        return false;
+
+    return m_thread->cancel(id);
+}
+
+/*! Returns the number of values waiting for their deadline. */
+int GpioScheduler::pendingCount() const
+{
+    if (!m_thread)
+        return 0;
+
+    return m_thread->pendingCount();
+}
+
+/*! Returns the largest skew in nanoseconds reported since the scheduler has been started. */
+qint64 GpioScheduler::maxSkew() const
+{
+    return m_maxSkew;
+}
+
+/*! Starts the scheduler thread. Returns false if the Gpio is not configured as output. Calling \l{scheduleValue()} starts the
+    scheduler automatically. */
+bool GpioScheduler::start()
+{
+    if (m_thread)
+        return true;
+
+    if (!m_gpio || m_gpio->direction() != Gpio::DirectionOutput) {
+        qCWarning(dcGpio()) << "GpioScheduler: The scheduler requires a GPIO configured as output.";
+        return false;
+    }
+
+    // Keep the value file open while the scheduler is running
+    m_persistentValueFile = m_gpio->persistentValueFile();
+    m_gpio->setPersistentValueFile(true);
+
+    m_maxSkew = 0;
+    m_thread = new GpioSchedulerThread(this, m_gpio);
+    m_thread->setRealtimePriority(m_realtimePriority);
+    m_thread->setCpuAffinity(m_cpuAffinity);
+    m_thread->start();
+    return true;
+}
+
+/*! Stops the scheduler thread and discards all pending values. The persistent value file setting of the Gpio will be restored. */
+void GpioScheduler::stop()
+{
+    if (!m_thread)
+        return;
+
+    delete m_thread;
+    m_thread = nullptr;
+
+    if (m_gpio)
+        m_gpio->setPersistentValueFile(m_persistentValueFile);
+}
+
+void GpioScheduler::onValueApplied(int id, bool success, qint64 skew)
+{
+    if (skew > m_maxSkew)
+        m_maxSkew = skew;
+
+    if (!success && m_gpio)
+        qCWarning(dcGpio()) << "GpioScheduler: Could not write the value" << id << "of GPIO" << m_gpio->gpioNumber();
+
+    emit valueApplied(id, success, skew);
+}
+
+void GpioScheduler::onGpioDestroyed()
+{
+    if (!m_thread)
+        return;
+
+    // The thread must not write to the Gpio any more, there is no setting left to restore
+    qCWarning(dcGpio()) << "GpioScheduler: The GPIO has been destroyed while the scheduler is running. Discarding all pending values.";
+    delete m_thread;
+    m_thread = nullptr;
+}
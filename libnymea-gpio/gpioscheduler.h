@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOSCHEDULER_H
+#define GPIOSCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+
+#include "gpio.h"
+#include "gpiorealtime.h"
+
+class GpioSchedulerThread;
+
+class GpioScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioScheduler(Gpio *gpio, QObject *parent = nullptr);
+    ~GpioScheduler() override;
+
+    Gpio *gpio() const;
+
+    int realtimePriority() const;
+    void setRealtimePriority(int realtimePriority);
+
+    int cpuAffinity() const;
+    void setCpuAffinity(int cpuAffinity);
+
+    bool isRunning() const;
+
+    int scheduleValue(Gpio::Value value, qint64 deadline, GpioRealtime::Clock clock = GpioRealtime::ClockMonotonic);
+    bool cancel(int id);
+    int pendingCount() const;
+
+    qint64 maxSkew() const;
+
+public slots:
+    bool start();
+    void stop();
+
+signals:
+    void valueApplied(int id, bool success, qint64 skew);
+
+private:
+    QPointer<Gpio> m_gpio;
+    int m_realtimePriority = 0;
+    int m_cpuAffinity = -1;
+    int m_nextId = 1;
+    qint64 m_maxSkew = 0;
+    bool m_persistentValueFile = false;
+
+    GpioSchedulerThread *m_thread = nullptr;
+
+private slots:
+    void onValueApplied(int id, bool success, qint64 skew);
+    void onGpioDestroyed();
+
+};
+
+#endif // GPIOSCHEDULER_H
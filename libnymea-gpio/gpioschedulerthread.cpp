@@ -0,0 +1,194 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioSchedulerThread
+    \brief The thread writing the scheduled values of a \l{GpioScheduler}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The thread waits on a condition until shortly before the next deadline, so newly scheduled values and cancellations
+    get picked up. The last milliseconds get spent in \tt clock_nanosleep on the absolute deadline of the clock the value has
+    been scheduled for, the last microseconds polling that clock. Values in this final phase can not be cancelled anymore.
+
+    \sa GpioScheduler
+*/
+
+#include "gpioschedulerthread.h"
+#include "gpioscheduler.h"
+
+// Deadlines closer than this are not waited for on the condition anymore
+static const qint64 wakeupThreshold = 2000000;
+
+// Waits shorter than this get spent polling the clock instead of sleeping
+static const qint64 spinThreshold = 50000;
+
+/*! Constructs the thread writing the values scheduled on \a scheduler to \a gpio. */
+GpioSchedulerThread::GpioSchedulerThread(GpioScheduler *scheduler, Gpio *gpio) :
+    QThread(),
+    m_scheduler(scheduler),
+    m_gpio(gpio)
+{
+    setObjectName("gpio-scheduler");
+}
+
+/*! Stops and destroys the thread. */
+GpioSchedulerThread::~GpioSchedulerThread()
+{
+    stop();
+}
+
+/*! Sets the \tt SCHED_FIFO \a priority of the thread. A priority of 0 keeps the default scheduling policy. */
+void GpioSchedulerThread::setRealtimePriority(int priority)
+{
+    m_priority = priority;
+}
+
+/*! Binds the thread to the given \a cpu. A value of -1 does not change the affinity. */
+void GpioSchedulerThread::setCpuAffinity(int cpu)
+{
+    m_cpu = cpu;
+}
+
+/*! Starts the thread. */
+void GpioSchedulerThread::start()
+{
+    if (isRunning())
+        return;
+
+    m_mutex.lock();
+    m_running = true;
+    m_mutex.unlock();
+    QThread::start();
+}
+
+/*! Discards all pending values and waits until the thread has finished. A value in its final phase will still be written. */
+void GpioSchedulerThread::stop()
+{
+    m_mutex.lock();
+    m_running = false;
+    m_entries.clear();
+    m_condition.wakeAll();
+    m_mutex.unlock();
+    wait();
+}
+
+/*! Schedules writing \a value once \a clock reached the absolute \a deadline in nanoseconds. The value will be reported using \a id. */
+void GpioSchedulerThread::schedule(int id, Gpio::Value value, qint64 deadline, GpioRealtime::Clock clock)
+{
+    Entry entry;
+    entry.id = id;
+    entry.value = value;
+    entry.deadline = deadline;
+    entry.clock = clock;
+
+    QMutexLocker locker(&m_mutex);
+    m_entries.append(entry);
+    m_condition.wakeAll();
+}
+
+/*! Removes the pending value with the given \a id. Returns false if the value has been written already or is in its final phase. */
+bool GpioSchedulerThread::cancel(int id)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < m_entries.count(); i++) {
+        if (m_entries.at(i).id == id) {
+            m_entries.remove(i);
+            m_condition.wakeAll();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*! Returns the number of values waiting for their deadline. */
+int GpioSchedulerThread::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.count();
+}
+
+void GpioSchedulerThread::run()
+{
+    if (m_priority > 0)
+        GpioRealtime::setCurrentThreadPriority(m_priority);
+
+    if (m_cpu >= 0)
+        GpioRealtime::setCurrentThreadAffinity(m_cpu);
+
+    QMutexLocker locker(&m_mutex);
+    while (m_running) {
+        if (m_entries.isEmpty()) {
+            m_condition.wait(&m_mutex);
+            continue;
+        }
+
+        qint64 monotonicDeadline = 0;
+        int index = nextEntry(&monotonicDeadline);
+        qint64 remaining = monotonicDeadline - GpioRealtime::monotonicTime();
+        if (remaining > wakeupThreshold) {
+            m_condition.wait(&m_mutex, static_cast<unsigned long>((remaining - wakeupThreshold) / 1000000 + 1));
+            continue;
+        }
+
+        Entry entry = m_entries.takeAt(index);
+        locker.unlock();
+
+        if (entry.deadline - GpioRealtime::currentTime(entry.clock) > spinThreshold)
+            GpioRealtime::sleepUntil(entry.deadline - spinThreshold, entry.clock);
+
+        while (GpioRealtime::currentTime(entry.clock) < entry.deadline) { }
+
+        bool success = m_gpio->setValue(entry.value);
+        qint64 skew = GpioRealtime::currentTime(entry.clock) - entry.deadline;
+        QMetaObject::invokeMethod(m_scheduler, "onValueApplied", Qt::QueuedConnection, Q_ARG(int, entry.id), Q_ARG(bool, success), Q_ARG(qint64, skew));
+
+        locker.relock();
+    }
+}
+
+// Requires the mutex to be locked, the deadlines of CLOCK_REALTIME get ordered by their distance to now
+int GpioSchedulerThread::nextEntry(qint64 *monotonicDeadline) const
+{
+    qint64 realtimeOffset = GpioRealtime::monotonicTime() - GpioRealtime::currentTime(GpioRealtime::ClockRealtime);
+
+    int index = -1;
+    for (int i = 0; i < m_entries.count(); i++) {
+        const Entry &entry = m_entries.at(i);
+        qint64 deadline = entry.clock == GpioRealtime::ClockRealtime ? entry.deadline + realtimeOffset : entry.deadline;
+        if (index < 0 || deadline < *monotonicDeadline) {
+            index = i;
+            *monotonicDeadline = deadline;
+        }
+    }
+
+    return index;
+}
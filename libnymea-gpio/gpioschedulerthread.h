@@ -0,0 +1,86 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOSCHEDULERTHREAD_H
+#define GPIOSCHEDULERTHREAD_H
+
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "gpio.h"
+#include "gpiorealtime.h"
+
+class GpioScheduler;
+
+class GpioSchedulerThread : public QThread
+{
+public:
+    explicit GpioSchedulerThread(GpioScheduler *scheduler, Gpio *gpio);
+    ~GpioSchedulerThread() override;
+
+    void setRealtimePriority(int priority);
+    void setCpuAffinity(int cpu);
+
+    void start();
+    void stop();
+
+    void schedule(int id, Gpio::Value value, qint64 deadline, GpioRealtime::Clock clock);
+    bool cancel(int id);
+    int pendingCount() const;
+
+protected:
+    void run() override;
+
+private:
+    struct Entry {
+        int id = -1;
+        Gpio::Value value = Gpio::ValueInvalid;
+        qint64 deadline = 0;
+        GpioRealtime::Clock clock = GpioRealtime::ClockMonotonic;
+    };
+
+    GpioScheduler *m_scheduler = nullptr;
+    Gpio *m_gpio = nullptr;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    QVector<Entry> m_entries;
+    bool m_running = false;
+
+    int m_priority = 0;
+    int m_cpu = -1;
+
+    int nextEntry(qint64 *monotonicDeadline) const;
+
+};
+
+#endif // GPIOSCHEDULERTHREAD_H
@@ -0,0 +1,135 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioStatistics
+    \brief A snapshot of the always-on counters of a \l{Gpio} or a \l{GpioMonitor}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The counters are plain increments on the hot paths, no time will be taken and nothing will be formatted while
+    the GPIO is in use. A snapshot can be taken at any time using \l{Gpio::statistics()} or
+    \l{GpioMonitor::statistics()} and printed using qDebug, which makes it possible to spot slow or noisy pins on a
+    running system without enabling the debug output.
+
+    \list
+        \li \c reads: values and attributes read from the kernel.
+        \li \c writes: values and attributes written to the kernel, \c elidedWrites counts the skipped ones
+            (\l{Gpio::setWriteElision()}).
+        \li \c errors: failed accesses of the kernel interface.
+        \li \c edges: edges read from the kernel by a \l{GpioMonitor}, \c droppedEdges the edges lost on the way.
+        \li \c latencyHistogram: the time from the timestamp of an edge to its delivery to the receiver in logarithmic
+            buckets (\l{latencyBucketLimit()}), \c maxLatency the largest latency seen in nanoseconds.
+    \endlist
+*/
+
+#include "gpiostatistics.h"
+
+/*! Returns the number of latencies recorded in the histogram. */
+quint64 GpioStatistics::latencyCount() const
+{
+    quint64 count = 0;
+    for (int i = 0; i < latencyBucketCount; i++)
+        count += latencyHistogram[i];
+
+    return count;
+}
+
+/*! Returns an upper estimate of the latency in nanoseconds below which the given \a percentile (0 - 1) of the recorded
+    latencies lie. The result is the limit of the histogram bucket containing the percentile, or \c maxLatency for the last
+    bucket. Returns 0 if no latencies have been recorded. */
+qint64 GpioStatistics::latencyPercentile(double percentile) const
+{
+    quint64 count = latencyCount();
+    if (count == 0)
+        return 0;
+
+    quint64 target = static_cast<quint64>(qBound(0.0, percentile, 1.0) * count);
+    quint64 sum = 0;
+    for (int i = 0; i < latencyBucketCount - 1; i++) {
+        sum += latencyHistogram[i];
+        if (sum > target)
+            return qMin(latencyBucketLimit(i), maxLatency);
+    }
+
+    return maxLatency;
+}
+
+/*! Returns the histogram bucket for the given \a latency in nanoseconds. Bucket 0 holds latencies below 1 µs, bucket n
+    latencies below 2^n µs and the last bucket everything above.
+
+    \sa latencyBucketLimit()
+*/
+int GpioStatistics::latencyBucket(qint64 latency)
+{
+    quint64 microseconds = latency > 0 ? static_cast<quint64>(latency) / 1000 : 0;
+    if (microseconds == 0)
+        return 0;
+
+    int bucket = 64 - __builtin_clzll(microseconds);
+    return qMin(bucket, latencyBucketCount - 1);
+}
+
+/*! Returns the exclusive upper limit in nanoseconds of the latencies in the given histogram \a bucket. The last bucket has
+    no upper limit and returns -1.
+
+    \sa latencyBucket()
+*/
+qint64 GpioStatistics::latencyBucketLimit(int bucket)
+{
+    if (bucket < 0 || bucket >= latencyBucketCount - 1)
+        return -1;
+
+    return 1000LL << bucket;
+}
+
+/*! Prints the given \a statistics to \a debug. */
+QDebug operator<<(QDebug debug, const GpioStatistics &statistics)
+{
+    debug.nospace() << "GpioStatistics(" << statistics.gpio
+                    << ", reads: " << statistics.reads
+                    << ", writes: " << statistics.writes
+                    << ", elided: " << statistics.elidedWrites
+                    << ", errors: " << statistics.errors;
+
+    if (statistics.edges > 0 || statistics.droppedEdges > 0) {
+        debug.nospace() << ", edges: " << statistics.edges
+                        << ", dropped: " << statistics.droppedEdges;
+    }
+
+    if (statistics.latencyCount() > 0) {
+        debug.nospace() << ", latency p50: " << statistics.latencyPercentile(0.5) / 1000
+                        << " us, p99: " << statistics.latencyPercentile(0.99) / 1000
+                        << " us, max: " << statistics.maxLatency / 1000 << " us";
+    }
+
+    debug.nospace() << ")";
+    return debug.space();
+}
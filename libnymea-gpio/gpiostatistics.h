@@ -0,0 +1,59 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOSTATISTICS_H
+#define GPIOSTATISTICS_H
+
+#include <QDebug>
+
+struct GpioStatistics
+{
+    static const int latencyBucketCount = 16;
+
+    int gpio = -1;
+    quint64 reads = 0;
+    quint64 writes = 0;
+    quint64 elidedWrites = 0;
+    quint64 errors = 0;
+    quint64 edges = 0;
+    quint64 droppedEdges = 0;
+    quint64 latencyHistogram[latencyBucketCount] = {};
+    qint64 maxLatency = 0;
+
+    quint64 latencyCount() const;
+    qint64 latencyPercentile(double percentile) const;
+
+    static int latencyBucket(qint64 latency);
+    static qint64 latencyBucketLimit(int bucket);
+};
+
+QDebug operator<< (QDebug debug, const GpioStatistics &statistics);
+
+#endif // GPIOSTATISTICS_H
@@ -0,0 +1,578 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioSysfsBackend
+    \brief The GpioBackend implementation for the legacy \tt {/sys/class/gpio} interface.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Every attribute access opens the corresponding file in \tt {/sys/class/gpio/gpio<number>}. Optionally the \tt value
+    file can be kept open (\l{Gpio::setPersistentValueFile()}). The persistent file will only be closed by the configuring
+    methods, which the Gpio calls while no value access is in progress. The \l{eventFd()} watched by a \l{GpioMonitor} is a
+    separate descriptor, so a failing value access does not affect the monitoring.
+
+    After writing the export file, the kernel creates the GPIO directory owned by root and udev adjusts the permissions of
+    the attribute files afterwards. \l{exportGpio()} waits using \tt inotify until the \tt direction and \tt value files
+    are writable, bounded by the \l{Gpio::setExportTimeout()}{export timeout}. Since sysfs does not reliably report the creation
+    of files, the attributes will also be checked in short intervals while waiting.
+
+    The sysfs interface does not provide kernel timestamps for interrupts, the timestamp of a \l{GpioEvent} will be
+    taken from \tt CLOCK_MONOTONIC at the time the value has been read.
+*/
+
+#include "gpiosysfsbackend.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+/*! Constructs the sysfs backend for the given \a gpio number. */
+GpioSysfsBackend::GpioSysfsBackend(int gpio) :
+    GpioBackend(gpio),
+    m_gpioDirectory(QDir(QString("%1/gpio%2").arg(sysfsPath()).arg(QString::number(gpio)))),
+    m_valueFd(-1),
+    m_valueFileFailed(0)
+{
+
+}
+
+/*! Destroys the backend and closes the persistent value file. */
+GpioSysfsBackend::~GpioSysfsBackend()
+{
+    closeValueFile();
+    closeEventFile();
+}
+
+/*! Returns true if the file \tt {/sys/class/gpio/export} does exist. */
+bool GpioSysfsBackend::isAvailable()
+{
+    return QFile(sysfsPath() + "/export").exists();
+}
+
+/*! Returns the directory of the sysfs GPIO interface. This is \tt {/sys/class/gpio} unless another directory has been
+    given using the environment variable \tt NYMEA_GPIO_SYSFS_PATH, i.e. a fake sysfs tree for testing. */
+QString GpioSysfsBackend::sysfsPath()
+{
+    QString path = QString::fromLocal8Bit(qgetenv("NYMEA_GPIO_SYSFS_PATH"));
+    if (path.isEmpty())
+        return "/sys/class/gpio";
+
+    return path;
+}
+
+/*! Returns \l{Gpio::BackendSysfs}. */
+Gpio::Backend GpioSysfsBackend::type() const
+{
+    return Gpio::BackendSysfs;
+}
+
+/*! Returns true if the GPIO could be exported in the system file \tt {/sys/class/gpio/export} and became accessible within the
+    export timeout. If the GPIO is already exported, this function will return true. */
+bool GpioSysfsBackend::exportGpio()
+{
+    // A failed persistent value file gets opened again
+    if (m_valueFileFailed.loadAcquire())
+        closeValueFile();
+
+    // Check if already exported
+    if (isExported()) {
+        qCDebug(dcGpio()) << "GPIO" << m_gpio << "already exported.";
+        return true;
+    }
+
+    if (!writeExport())
+        return false;
+
+    return waitForExport(m_exportTimeout);
+}
+
+/*! Returns true if the directory \tt {/sys/class/gpio/gpio<number>} of this GPIO does exist. */
+bool GpioSysfsBackend::isExported() const
+{
+    return m_gpioDirectory.exists();
+}
+
+/*! Writes the GPIO number to the system file \tt {/sys/class/gpio/export} without waiting for the GPIO to become accessible.
+
+    \sa waitForExport()
+*/
+bool GpioSysfsBackend::writeExport()
+{
+    QFile exportFile(sysfsPath() + "/export");
+    if (!exportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO export file:" << exportFile.errorString();
+        return false;
+    }
+
+    QTextStream out(&exportFile);
+    out << m_gpio;
+    exportFile.close();
+    return true;
+}
+
+/*! Returns true if the GPIO could be unexported in the system file \tt {/sys/class/gpio/unexport}. */
+bool GpioSysfsBackend::unexportGpio()
+{
+    closeValueFile();
+    closeEventFile();
+
+    QFile unexportFile(sysfsPath() + "/unexport");
+    if (!unexportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO unexport file:" << unexportFile.errorString();
+        return false;
+    }
+
+    QTextStream out(&unexportFile);
+    out << m_gpio;
+    unexportFile.close();
+    return true;
+}
+
+/*! Writes the \a direction to the \tt direction file of the GPIO. */
+bool GpioSysfsBackend::setDirection(Gpio::Direction direction)
+{
+    QFile directionFile(m_gpioDirectory.path() + QDir::separator() + "direction");
+    if (!directionFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "direction file:" << directionFile.errorString();
+        return false;
+    }
+
+    QTextStream out(&directionFile);
+    switch (direction) {
+    case Gpio::DirectionInput:
+        out << "in";
+        break;
+    case Gpio::DirectionOutput:
+        out << "out";
+        break;
+    default:
+        break;
+    }
+
+    directionFile.close();
+    return true;
+}
+
+/*! Reads the direction from the \tt direction file of the GPIO. */
+Gpio::Direction GpioSysfsBackend::direction()
+{
+    QFile directionFile(m_gpioDirectory.path() + QDir::separator() + "direction");
+    if (!directionFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "direction file:" << directionFile.fileName() << directionFile.errorString();
+        return Gpio::DirectionInvalid;
+    }
+
+    QString direction;
+    QTextStream in(&directionFile);
+    in >> direction;
+    directionFile.close();
+
+    if (direction == "in") {
+        return Gpio::DirectionInput;
+    } else if (direction == "out") {
+        return Gpio::DirectionOutput;
+    }
+
+    return Gpio::DirectionInvalid;
+}
+
+/*! Writes the \a value to the \tt value file of the GPIO. */
+bool GpioSysfsBackend::setValue(Gpio::Value value)
+{
+    if (usePersistentValueFile()) {
+        const char data = (value == Gpio::ValueHigh ? '1' : '0');
+        if (pwrite(m_valueFd.loadAcquire(), &data, 1, 0) == 1)
+            return true;
+
+        qCWarning(dcGpio()) << "Could not write persistent value file of GPIO" << m_gpio << ":" << strerror(errno) << "Falling back to per call access.";
+        m_valueFileFailed.storeRelease(1);
+    }
+
+    QFile valueFile(m_gpioDirectory.path() + QDir::separator() + "value");
+    if (!valueFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "value file:" << valueFile.errorString();
+        return false;
+    }
+
+    QTextStream out(&valueFile);
+    switch (value) {
+    case Gpio::ValueLow:
+        out << "0";
+        break;
+    case Gpio::ValueHigh:
+        out << "1";
+        break;
+    default:
+        valueFile.close();
+        return false;
+    }
+
+    valueFile.close();
+    return true;
+}
+
+/*! Reads the value from the \tt value file of the GPIO. */
+Gpio::Value GpioSysfsBackend::value()
+{
+    if (usePersistentValueFile()) {
+        char data[2];
+        if (pread(m_valueFd.loadAcquire(), data, sizeof(data), 0) > 0) {
+            if (data[0] == '0') {
+                return Gpio::ValueLow;
+            } else if (data[0] == '1') {
+                return Gpio::ValueHigh;
+            }
+            return Gpio::ValueInvalid;
+        }
+
+        qCWarning(dcGpio()) << "Could not read persistent value file of GPIO" << m_gpio << ":" << strerror(errno) << "Falling back to per call access.";
+        m_valueFileFailed.storeRelease(1);
+    }
+
+    QFile valueFile(m_gpioDirectory.path() + QDir::separator() + "value");
+    if (!valueFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "value file:" << valueFile.errorString();
+        return Gpio::ValueInvalid;
+    }
+
+    QString value;
+    QTextStream in(&valueFile);
+    in >> value;
+    valueFile.close();
+
+    if (value == "0") {
+        return Gpio::ValueLow;
+    } else if (value == "1") {
+        return Gpio::ValueHigh;
+    }
+
+    return Gpio::ValueInvalid;
+}
+
+/*! Writes \a activeLow to the \tt active_low file of the GPIO. */
+bool GpioSysfsBackend::setActiveLow(bool activeLow)
+{
+    QFile activeLowFile(m_gpioDirectory.path() + QDir::separator() + "active_low");
+    if (!activeLowFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "active_low file:" << activeLowFile.errorString();
+        return false;
+    }
+
+    QTextStream out(&activeLowFile);
+    if (activeLow) {
+        out << "1";
+    } else {
+        out << "0";
+    }
+
+    activeLowFile.close();
+    return true;
+}
+
+/*! Reads the \tt active_low file of the GPIO. */
+bool GpioSysfsBackend::activeLow()
+{
+    QFile activeLowFile(m_gpioDirectory.path() + QDir::separator() + "active_low");
+    if (!activeLowFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "active_low file:" << activeLowFile.errorString();
+        return false;
+    }
+
+    QString value;
+    QTextStream in(&activeLowFile);
+    in >> value;
+    activeLowFile.close();
+
+    if (value == "1")
+        return true;
+
+    return false;
+}
+
+/*! Writes the \a edge to the \tt edge file of the GPIO. */
+bool GpioSysfsBackend::setEdgeInterrupt(Gpio::Edge edge)
+{
+    QFile edgeFile(m_gpioDirectory.path() + QDir::separator() + "edge");
+    if (!edgeFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "edge file:" << edgeFile.errorString();
+        return false;
+    }
+
+    QTextStream out(&edgeFile);
+    switch (edge) {
+    case Gpio::EdgeFalling:
+        out << "falling";
+        break;
+    case Gpio::EdgeRising:
+        out << "rising";
+        break;
+    case Gpio::EdgeBoth:
+        out << "both";
+        break;
+    case Gpio::EdgeNone:
+        out << "none";
+        break;
+    }
+
+    edgeFile.close();
+    return true;
+}
+
+/*! Reads the \tt edge file of the GPIO. */
+Gpio::Edge GpioSysfsBackend::edgeInterrupt()
+{
+    QFile edgeFile(m_gpioDirectory.path() + QDir::separator() + "edge");
+    if (!edgeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(dcGpio()) << "Could not open GPIO" << m_gpio << "edge file:" << edgeFile.errorString();
+        return Gpio::EdgeNone;
+    }
+
+    QString edge;
+    QTextStream in(&edgeFile);
+    in >> edge;
+    edgeFile.close();
+
+    if (edge.contains("falling")) {
+        return Gpio::EdgeFalling;
+    } else if (edge.contains("rising")) {
+        return Gpio::EdgeRising;
+    } else if (edge.contains("both")) {
+        return Gpio::EdgeBoth;
+    } else if (edge.contains("none")) {
+        return Gpio::EdgeNone;
+    }
+
+    return Gpio::EdgeNone;
+}
+
+/*! Enables or disables the persistent \tt value file access depending on \a persistentValueFile. */
+void GpioSysfsBackend::setPersistentValueFile(bool persistentValueFile)
+{
+    m_persistentValueFile = persistentValueFile;
+    if (!m_persistentValueFile || m_valueFileFailed.loadAcquire()) {
+        closeValueFile();
+    }
+}
+
+/*! Sets the time in milliseconds \l{exportGpio()} waits until the \tt direction and \tt value files are writable to \a exportTimeout. */
+void GpioSysfsBackend::setExportTimeout(int exportTimeout)
+{
+    m_exportTimeout = qMax(exportTimeout, 0);
+}
+
+/*! Waits at most \a timeout milliseconds until the \tt direction and \tt value files of the exported GPIO are writable.
+    Returns true as soon as they are, false if the timeout has been reached. */
+bool GpioSysfsBackend::waitForExport(int timeout)
+{
+    if (!waitForWritable(m_gpioDirectory.path(), QStringList() << "direction" << "value", timeout)) {
+        qCWarning(dcGpio()) << "GPIO" << m_gpio << "did not become accessible within" << timeout << "ms after export.";
+        return false;
+    }
+
+    return true;
+}
+
+/*! Waits at most \a timeout milliseconds until all \a fileNames in the sysfs \a directory are writable. The directory does not
+    have to exist yet, its creation will be watched in the parent directory. Returns true as soon as the files are writable,
+    false if the timeout has been reached.
+
+    After an export, the kernel creates the new directory owned by root and udev adjusts the permissions afterwards. This
+    waits using \tt inotify, and since sysfs does not reliably report the creation of files, checks again in short intervals.
+*/
+bool GpioSysfsBackend::waitForWritable(const QString &directory, const QStringList &fileNames, int timeout)
+{
+    QList<QByteArray> files;
+    foreach (const QString &fileName, fileNames)
+        files.append(QString(directory + QDir::separator() + fileName).toLocal8Bit());
+
+    auto writable = [&files]() {
+        foreach (const QByteArray &file, files) {
+            if (access(file.constData(), W_OK) != 0)
+                return false;
+        }
+        return true;
+    };
+
+    if (writable())
+        return true;
+
+    int inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (inotifyFd < 0)
+        qCWarning(dcGpio()) << "Could not create inotify instance for" << directory << ":" << strerror(errno);
+
+    QByteArray watchedDirectory = directory.toLocal8Bit();
+    bool directoryWatched = false;
+    if (inotifyFd >= 0) {
+        inotify_add_watch(inotifyFd, QFileInfo(directory).absolutePath().toLocal8Bit().constData(), IN_CREATE);
+        directoryWatched = inotify_add_watch(inotifyFd, watchedDirectory.constData(), IN_ATTRIB | IN_CREATE) >= 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    bool accessible = false;
+    while (!accessible) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        qint64 elapsed = static_cast<qint64>(now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (elapsed >= timeout)
+            break;
+
+        // Sysfs does not reliably report new files, check again after a short interval anyways
+        struct pollfd fd;
+        fd.fd = inotifyFd;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        poll(&fd, inotifyFd >= 0 ? 1 : 0, static_cast<int>(qMin<qint64>(timeout - elapsed, 10)));
+
+        if (fd.revents & POLLIN) {
+            char buffer[4096];
+            while (::read(inotifyFd, buffer, sizeof(buffer)) > 0) { }
+        }
+
+        if (inotifyFd >= 0 && !directoryWatched)
+            directoryWatched = inotify_add_watch(inotifyFd, watchedDirectory.constData(), IN_ATTRIB | IN_CREATE) >= 0;
+
+        accessible = writable();
+    }
+
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+
+    return accessible;
+}
+
+/*! Returns a descriptor of the \tt value file, which signals interrupts using \tt POLLPRI. The descriptor is not shared
+    with the persistent value file and stays open until the GPIO gets unexported. */
+int GpioSysfsBackend::eventFd()
+{
+    if (m_eventFd >= 0)
+        return m_eventFd;
+
+    QByteArray fileName = QString(m_gpioDirectory.path() + QDir::separator() + "value").toLocal8Bit();
+    m_eventFd = ::open(fileName.constData(), O_RDONLY | O_CLOEXEC);
+    if (m_eventFd < 0)
+        qCWarning(dcGpio()) << "Could not open value file of GPIO" << m_gpio << "for interrupts:" << strerror(errno);
+
+    return m_eventFd;
+}
+
+/*! Returns QSocketNotifier::Exception, since sysfs signals interrupts using \tt POLLPRI. */
+QSocketNotifier::Type GpioSysfsBackend::eventNotifierType() const
+{
+    return QSocketNotifier::Exception;
+}
+
+/*! Reads the current value into \a events. The sysfs interface does not queue interrupts, therefore
+    at most one event will be read, regardless of \a maxEvents. */
+int GpioSysfsBackend::readEvents(GpioEvent *events, int maxEvents)
+{
+    if (maxEvents <= 0 || m_eventFd < 0)
+        return 0;
+
+    char data[2];
+    if (pread(m_eventFd, data, sizeof(data), 0) <= 0) {
+        qCWarning(dcGpio()) << "Could not read value file of GPIO" << m_gpio << ":" << strerror(errno);
+        return -1;
+    }
+
+    if (data[0] != '0' && data[0] != '1')
+        return 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    events[0].value = (data[0] == '1');
+    events[0].timestamp = static_cast<qint64>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    events[0].sequence = 0;
+    return 1;
+}
+
+/*! Returns false, since every read of the \tt value file returns the current value instead of a queued interrupt. */
+bool GpioSysfsBackend::queuesEvents() const
+{
+    return false;
+}
+
+bool GpioSysfsBackend::openValueFile()
+{
+    if (m_valueFd.loadAcquire() >= 0)
+        return true;
+
+    QByteArray fileName = QString(m_gpioDirectory.path() + QDir::separator() + "value").toLocal8Bit();
+    int valueFd = ::open(fileName.constData(), O_RDWR | O_CLOEXEC);
+    if (valueFd < 0) {
+        // Inputs might not be writable, reading is still possible
+        valueFd = ::open(fileName.constData(), O_RDONLY | O_CLOEXEC);
+    }
+
+    if (valueFd < 0) {
+        qCWarning(dcGpio()) << "Could not open value file of GPIO" << m_gpio << ":" << strerror(errno);
+        return false;
+    }
+
+    // Another thread accessing the value might have been faster
+    if (!m_valueFd.testAndSetOrdered(-1, valueFd))
+        ::close(valueFd);
+
+    return true;
+}
+
+// Must only be called while no value access is in progress
+void GpioSysfsBackend::closeValueFile()
+{
+    int valueFd = m_valueFd.fetchAndStoreOrdered(-1);
+    if (valueFd >= 0)
+        ::close(valueFd);
+
+    m_valueFileFailed.storeRelease(0);
+}
+
+void GpioSysfsBackend::closeEventFile()
+{
+    if (m_eventFd >= 0)
+        ::close(m_eventFd);
+
+    m_eventFd = -1;
+}
+
+bool GpioSysfsBackend::usePersistentValueFile()
+{
+    return m_persistentValueFile && !m_valueFileFailed.loadAcquire() && openValueFile();
+}
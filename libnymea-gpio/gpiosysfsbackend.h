@@ -0,0 +1,96 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOSYSFSBACKEND_H
+#define GPIOSYSFSBACKEND_H
+
+#include <QDir>
+#include <QAtomicInteger>
+
+#include "gpiobackend.h"
+
+class GpioSysfsBackend : public GpioBackend
+{
+public:
+    explicit GpioSysfsBackend(int gpio);
+    ~GpioSysfsBackend() override;
+
+    static bool isAvailable();
+    static QString sysfsPath();
+
+    Gpio::Backend type() const override;
+
+    bool exportGpio() override;
+    bool unexportGpio() override;
+
+    bool setDirection(Gpio::Direction direction) override;
+    Gpio::Direction direction() override;
+
+    bool setValue(Gpio::Value value) override;
+    Gpio::Value value() override;
+
+    bool setActiveLow(bool activeLow) override;
+    bool activeLow() override;
+
+    bool setEdgeInterrupt(Gpio::Edge edge) override;
+    Gpio::Edge edgeInterrupt() override;
+
+    void setPersistentValueFile(bool persistentValueFile) override;
+    void setExportTimeout(int exportTimeout) override;
+
+    bool isExported() const;
+    bool writeExport();
+    bool waitForExport(int timeout);
+
+    static bool waitForWritable(const QString &directory, const QStringList &fileNames, int timeout);
+
+    int eventFd() override;
+    QSocketNotifier::Type eventNotifierType() const override;
+    int readEvents(GpioEvent *events, int maxEvents) override;
+    bool queuesEvents() const override;
+
+private:
+    QDir m_gpioDirectory;
+
+    bool m_persistentValueFile = false;
+    QAtomicInt m_valueFd;
+    QAtomicInt m_valueFileFailed;
+    int m_eventFd = -1;
+    int m_exportTimeout = 1000;
+
+
+    bool openValueFile();
+    void closeValueFile();
+    void closeEventFile();
+    bool usePersistentValueFile();
+
+};
+
+#endif // GPIOSYSFSBACKEND_H
@@ -0,0 +1,228 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioTimerScheduler
+    \brief Shares one timer between many GPIO objects which need timeouts.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Each \l{GpioButton} uses its own precise QTimer to detect long presses. On panels with dozens of buttons this costs many
+    kernel timers and event loop wakeups. A GpioTimerScheduler multiplexes any number of timers onto one QTimer, which
+    always waits for the earliest deadline only. The deadlines get rounded up to the \l{resolution()}, so timers expiring
+    close to each other get handled in the same wakeup.
+
+    A timer is identified by the id returned from \l{registerTimer()} and calls its callback with the registered context
+    whenever it expires. Repeating timers advance their unrounded deadline by the interval and only the wakeup gets rounded,
+    so they do not drift, even if the interval is not a multiple of the resolution.
+
+    \code
+        GpioTimerScheduler *scheduler = new GpioTimerScheduler(this);
+        foreach (int gpio, buttonGpios) {
+            GpioButton *button = new GpioButton(gpio, this);
+            button->setTimerScheduler(scheduler);
+            button->enable();
+        }
+    \endcode
+
+    The scheduler and its users have to live in the same thread.
+
+    \sa GpioButton::setTimerScheduler()
+*/
+
+/*! \typedef GpioTimerScheduler::Callback
+    The function called with the registered context once a timer expired.
+*/
+
+#include "gpiotimerscheduler.h"
+#include "gpio.h"
+
+/*! Constructs a GpioTimerScheduler with the given \a parent. */
+GpioTimerScheduler::GpioTimerScheduler(QObject *parent) :
+    QObject(parent)
+{
+    m_clock.start();
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &GpioTimerScheduler::onTimeout);
+}
+
+/*! Destroys the GpioTimerScheduler. Registered timers will not expire any more. */
+GpioTimerScheduler::~GpioTimerScheduler()
+{
+    if (!m_queue.isEmpty())
+        qCDebug(dcGpio()) << "GpioTimerScheduler: Destroying scheduler with" << m_queue.count() << "active timers.";
+}
+
+/*! Returns the resolution of the deadlines in milliseconds. The default is 5 ms. */
+int GpioTimerScheduler::resolution() const
+{
+    return m_resolution;
+}
+
+/*! Sets the \a resolution of the deadlines in milliseconds. Deadlines will be rounded up to a multiple of the resolution,
+    timers expiring within the same period get handled with one wakeup. A higher resolution saves wakeups at the cost of
+    accuracy. This applies to timers started afterwards. */
+void GpioTimerScheduler::setResolution(int resolution)
+{
+    m_resolution = qMax(resolution, 1);
+}
+
+/*! Registers a new timer calling \a callback with \a context once it expires and returns the id of the timer.
+    The timer will be inactive until it gets started using \l{start()}. */
+int GpioTimerScheduler::registerTimer(GpioTimerScheduler::Callback callback, void *context)
+{
+    int timerId;
+    if (!m_freeEntries.isEmpty()) {
+        timerId = m_freeEntries.takeLast();
+    } else {
+        timerId = m_entries.count();
+        m_entries.append(Entry());
+    }
+
+    Entry &entry = m_entries[timerId];
+    entry = Entry();
+    entry.callback = callback;
+    entry.context = context;
+    entry.registered = true;
+    return timerId;
+}
+
+/*! Stops and removes the timer with the given \a timerId. The id may be reused by timers registered afterwards. */
+void GpioTimerScheduler::unregisterTimer(int timerId)
+{
+    if (timerId < 0 || timerId >= m_entries.count() || !m_entries.at(timerId).registered)
+        return;
+
+    stop(timerId);
+    m_entries[timerId] = Entry();
+    m_freeEntries.append(timerId);
+}
+
+/*! Starts or restarts the timer with the given \a timerId to expire after \a interval milliseconds. If \a repeating is true,
+    the timer expires every \a interval milliseconds until it gets stopped. */
+void GpioTimerScheduler::start(int timerId, int interval, bool repeating)
+{
+    if (timerId < 0 || timerId >= m_entries.count() || !m_entries.at(timerId).registered) {
+        qCWarning(dcGpio()) << "GpioTimerScheduler: Cannot start unknown timer" << timerId;
+        return;
+    }
+
+    stop(timerId);
+
+    Entry &entry = m_entries[timerId];
+    entry.interval = qMax(interval, repeating ? 1 : 0);
+    entry.repeating = repeating;
+    enqueue(timerId, m_clock.elapsed() + entry.interval);
+    rescheduleTimer();
+}
+
+/*! Stops the timer with the given \a timerId. */
+void GpioTimerScheduler::stop(int timerId)
+{
+    if (timerId < 0 || timerId >= m_entries.count())
+        return;
+
+    Entry &entry = m_entries[timerId];
+    if (entry.deadline < 0)
+        return;
+
+    m_queue.remove(entry.deadline, timerId);
+    entry.deadline = -1;
+    entry.nominalDeadline = -1;
+    rescheduleTimer();
+}
+
+/*! Returns true if the timer with the given \a timerId has been started and did not expire yet. Repeating timers stay active until they get stopped. */
+bool GpioTimerScheduler::isActive(int timerId) const
+{
+    if (timerId < 0 || timerId >= m_entries.count())
+        return false;
+
+    return m_entries.at(timerId).deadline >= 0;
+}
+
+/*! Returns the number of timers currently waiting to expire. */
+int GpioTimerScheduler::activeTimers() const
+{
+    return m_queue.count();
+}
+
+void GpioTimerScheduler::enqueue(int timerId, qint64 deadline)
+{
+    // Round up to the resolution so close deadlines share one wakeup, the nominal deadline stays exact
+    qint64 slot = ((deadline + m_resolution - 1) / m_resolution) * m_resolution;
+    m_entries[timerId].deadline = slot;
+    m_entries[timerId].nominalDeadline = deadline;
+    m_queue.insert(slot, timerId);
+}
+
+void GpioTimerScheduler::rescheduleTimer()
+{
+    if (m_queue.isEmpty()) {
+        m_timer->stop();
+        return;
+    }
+
+    qint64 remaining = m_queue.firstKey() - m_clock.elapsed();
+    m_timer->start(static_cast<int>(qMax<qint64>(remaining, 0)));
+}
+
+void GpioTimerScheduler::onTimeout()
+{
+    qint64 now = m_clock.elapsed();
+    while (!m_queue.isEmpty() && m_queue.firstKey() <= now) {
+        QMultiMap<qint64, int>::iterator it = m_queue.begin();
+        int timerId = it.value();
+        m_queue.erase(it);
+
+        Entry &entry = m_entries[timerId];
+        qint64 nominalDeadline = entry.nominalDeadline;
+        entry.deadline = -1;
+        entry.nominalDeadline = -1;
+        if (entry.repeating) {
+            // Skip the periods missed by a late wakeup, but keep the phase
+            qint64 next = nominalDeadline + entry.interval;
+            if (next <= now)
+                next += ((now - next) / entry.interval + 1) * entry.interval;
+
+            enqueue(timerId, next);
+        }
+
+        // The callback might start, stop or unregister any timer
+        GpioTimerScheduler::Callback callback = entry.callback;
+        void *context = entry.context;
+        callback(context);
+    }
+
+    rescheduleTimer();
+}
@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOTIMERSCHEDULER_H
+#define GPIOTIMERSCHEDULER_H
+
+#include <QTimer>
+#include <QObject>
+#include <QVector>
+#include <QMap>
+#include <QElapsedTimer>
+
+class GpioTimerScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef void (*Callback)(void *context);
+
+    explicit GpioTimerScheduler(QObject *parent = nullptr);
+    ~GpioTimerScheduler() override;
+
+    int resolution() const;
+    void setResolution(int resolution);
+
+    int registerTimer(GpioTimerScheduler::Callback callback, void *context);
+    void unregisterTimer(int timerId);
+
+    void start(int timerId, int interval, bool repeating = false);
+    void stop(int timerId);
+    bool isActive(int timerId) const;
+
+    int activeTimers() const;
+
+private:
+    struct Entry {
+        GpioTimerScheduler::Callback callback = nullptr;
+        void *context = nullptr;
+        qint64 deadline = -1;
+        qint64 nominalDeadline = -1;
+        int interval = 0;
+        bool repeating = false;
+        bool registered = false;
+    };
+
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_clock;
+    int m_resolution = 5;
+
+    QVector<Entry> m_entries;
+    QVector<int> m_freeEntries;
+    QMultiMap<qint64, int> m_queue;
+
+    void enqueue(int timerId, qint64 deadline);
+    void rescheduleTimer();
+
+private slots:
+    void onTimeout();
+
+};
+
+#endif // GPIOTIMERSCHEDULER_H
@@ -0,0 +1,275 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioTrace
+    \brief Trace points for the per value paths of the library.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Printing a debug message for every \l{Gpio::setValue()} takes more time than the I/O itself, which changes the timing
+    of the system under observation. The per value paths of the library (setting the value and the configuration of a
+    \l{Gpio}, reading the value and each edge read by a \l{GpioMonitor}) therefore use trace points instead of debug
+    messages. A trace point costs two flag checks as long as neither tracing nor the debug output of the \tt Gpio logging
+    category are enabled.
+
+    \chapter Debug output
+    If the debug output is enabled, each trace point prints at most \l{rateLimit()} messages per second. The number of
+    suppressed messages will be appended to the next message printed by the trace point.
+
+    \chapter Binary trace
+    While tracing is enabled using \l{start()}, each trace point stores a fixed size GpioTraceRecord with a
+    \tt CLOCK_MONOTONIC timestamp in a static ring buffer of \l{capacity} records, like a flight recorder. Recording does not
+    allocate, lock or format anything and it works from any thread, including the real-time threads of the library. Once
+    \l{stop()} has been called, the last records can be taken using \l{records()} or written to a file using \l{save()}.
+
+    \code
+        GpioTrace::start();
+        runTheSequence();
+        GpioTrace::stop();
+        GpioTrace::save("/tmp/gpio.trace");
+    \endcode
+
+    \chapter Build option
+    Building the library with \tt {qmake CONFIG+=gpio_no_trace} removes all trace points at compile time.
+*/
+
+/*!
+    \enum GpioTrace::Point
+    This enum type specifies the trace point of a GpioTraceRecord.
+
+    \value PointSetDirection
+        Gpio::setDirection(), the value is the Gpio::Direction.
+    \value PointSetValue
+        Gpio::setValue(), the value is the Gpio::Value.
+    \value PointValue
+        Gpio::value(), the value is the Gpio::Value which has been read.
+    \value PointSetActiveLow
+        Gpio::setActiveLow(), the value is 1 for active low.
+    \value PointSetEdgeInterrupt
+        Gpio::setEdgeInterrupt(), the value is the Gpio::Edge.
+    \value PointEdge
+        An edge read by a GpioMonitor, the value is the value after the edge.
+*/
+
+/*! \fn bool GpioTrace::isEnabled();
+    Returns true if the trace points will be recorded.
+*/
+
+/*!
+    \variable GpioTrace::capacity
+    The number of records kept in the trace buffer.
+*/
+
+/*!
+    \class GpioTraceRateLimit
+    \brief Limits the debug messages of one trace point.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Each \c GPIO_TRACE call site owns one rate limit, it allows \l{GpioTrace::rateLimit()} messages per second.
+*/
+
+#include "gpiotrace.h"
+#include "gpiorealtime.h"
+
+#include <QFile>
+
+#include <string.h>
+
+QAtomicInt GpioTrace::s_enabled;
+
+// Lives in the bss segment, untouched pages do not cost memory
+static GpioTraceRecord s_records[GpioTrace::capacity];
+static QAtomicInteger<quint64> s_head;
+static QAtomicInt s_rateLimit(100);
+
+/*! Returns true if the message may be printed. The number of messages suppressed since the last printed message
+    will be written to \a suppressed. */
+bool GpioTraceRateLimit::allow(int *suppressed)
+{
+    *suppressed = 0;
+
+    int rateLimit = GpioTrace::rateLimit();
+    if (rateLimit <= 0)
+        return true;
+
+    qint64 now = GpioRealtime::monotonicTime();
+    qint64 windowStart = m_windowStart.loadAcquire();
+    if (now - windowStart >= 1000000000LL && m_windowStart.testAndSetOrdered(windowStart, now)) {
+        *suppressed = m_suppressed.fetchAndStoreOrdered(0);
+        m_messages.storeRelease(1);
+        return true;
+    }
+
+    if (m_messages.fetchAndAddOrdered(1) < rateLimit)
+        return true;
+
+    m_suppressed.fetchAndAddOrdered(1);
+    return false;
+}
+
+/*! Discards the previous records and starts recording the trace points. */
+void GpioTrace::start()
+{
+    s_head.storeRelease(0);
+    s_enabled.storeRelease(1);
+}
+
+/*! Stops recording the trace points. The records stay available until the next \l{start()}. */
+void GpioTrace::stop()
+{
+    s_enabled.storeRelease(0);
+}
+
+/*! Returns the number of records available, at most \l{capacity}. */
+quint64 GpioTrace::recordCount()
+{
+    return qMin<quint64>(s_head.loadAcquire(), capacity);
+}
+
+/*! Returns the available records, the oldest one first. Call \l{stop()} before, otherwise records might be
+    overwritten while copying them. */
+QVector<GpioTraceRecord> GpioTrace::records()
+{
+    quint64 head = s_head.loadAcquire();
+    quint64 count = qMin<quint64>(head, capacity);
+
+    QVector<GpioTraceRecord> records;
+    records.reserve(static_cast<int>(count));
+    for (quint64 i = head - count; i < head; i++)
+        records.append(s_records[i & (capacity - 1)]);
+
+    return records;
+}
+
+/*! Writes the available records to the file with the given \a fileName. The file starts with a GpioTraceHeader followed by
+    the records, the oldest one first. Returns false if the file could not be written. */
+bool GpioTrace::save(const QString &fileName)
+{
+    QVector<GpioTraceRecord> traceRecords = records();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(dcGpio()) << "GpioTrace: Could not open" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    GpioTraceHeader header;
+    memcpy(header.magic, "NGTR", sizeof(header.magic));
+    header.version = 1;
+    header.count = static_cast<quint64>(traceRecords.count());
+
+    qint64 size = static_cast<qint64>(traceRecords.count() * sizeof(GpioTraceRecord));
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header) ||
+            file.write(reinterpret_cast<const char *>(traceRecords.constData()), size) != size) {
+        qCWarning(dcGpio()) << "GpioTrace: Could not write" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+/*! Returns the maximal number of debug messages per trace point and second. The default is 100.
+
+    \sa setRateLimit()
+*/
+int GpioTrace::rateLimit()
+{
+    return s_rateLimit.loadAcquire();
+}
+
+/*! Sets the maximal number of debug messages per trace point and second to \a rateLimit. A value of 0 disables the limit. */
+void GpioTrace::setRateLimit(int rateLimit)
+{
+    s_rateLimit.storeRelease(qMax(rateLimit, 0));
+}
+
+/*! Returns the name of the trace \a point. */
+const char *GpioTrace::pointName(int point)
+{
+    switch (point) {
+    case PointSetDirection:
+        return "set direction";
+    case PointSetValue:
+        return "set value";
+    case PointValue:
+        return "value";
+    case PointSetActiveLow:
+        return "set active low";
+    case PointSetEdgeInterrupt:
+        return "set edge interrupt";
+    case PointEdge:
+        return "edge";
+    default:
+        return "unknown";
+    }
+}
+
+/*! Stores a record of the trace \a point for the given \a gpio and \a value. Use the \c GPIO_TRACE macro instead of calling
+    this method directly. */
+void GpioTrace::record(int point, int gpio, int value)
+{
+    GpioTraceRecord &record = s_records[s_head.fetchAndAddRelaxed(1) & (capacity - 1)];
+    record.timestamp = GpioRealtime::monotonicTime();
+    record.gpio = gpio;
+    record.point = static_cast<quint16>(point);
+    record.value = static_cast<qint16>(value);
+}
+
+/*! Prints the debug message of the trace \a point for the given \a gpio and \a value if the \a rateLimit allows it. Use the
+    \c GPIO_TRACE macro instead of calling this method directly. */
+void GpioTrace::log(GpioTraceRateLimit *rateLimit, int point, int gpio, int value)
+{
+    int suppressed = 0;
+    if (!rateLimit->allow(&suppressed))
+        return;
+
+    QDebug debug = qDebug(dcGpio()).nospace();
+    debug << "GPIO " << gpio << " " << pointName(point) << ": ";
+    switch (point) {
+    case PointSetDirection:
+        debug << static_cast<Gpio::Direction>(value);
+        break;
+    case PointSetValue:
+    case PointValue:
+        debug << static_cast<Gpio::Value>(value);
+        break;
+    case PointSetEdgeInterrupt:
+        debug << static_cast<Gpio::Edge>(value);
+        break;
+    default:
+        debug << value;
+        break;
+    }
+
+    if (suppressed > 0)
+        debug << " (" << suppressed << " messages suppressed)";
+}
@@ -0,0 +1,124 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOTRACE_H
+#define GPIOTRACE_H
+
+#include <QAtomicInteger>
+#include <QVector>
+
+#include "gpio.h"
+
+// The binary layout of a trace file, all values in host byte order
+struct GpioTraceHeader
+{
+    char magic[4];
+    quint32 version;
+    quint64 count;
+};
+
+struct GpioTraceRecord
+{
+    qint64 timestamp;
+    qint32 gpio;
+    quint16 point;
+    qint16 value;
+};
+
+class GpioTraceRateLimit
+{
+public:
+    bool allow(int *suppressed);
+
+private:
+    QAtomicInteger<qint64> m_windowStart;
+    QAtomicInt m_messages;
+    QAtomicInt m_suppressed;
+
+};
+
+class GpioTrace
+{
+public:
+    enum Point {
+        PointSetDirection,
+        PointSetValue,
+        PointValue,
+        PointSetActiveLow,
+        PointSetEdgeInterrupt,
+        PointEdge
+    };
+
+    static const int capacity = 65536;
+
+    static void start();
+    static void stop();
+    static bool isEnabled();
+
+    static quint64 recordCount();
+    static QVector<GpioTraceRecord> records();
+    static bool save(const QString &fileName);
+
+    static int rateLimit();
+    static void setRateLimit(int rateLimit);
+
+    static const char *pointName(int point);
+
+    static void record(int point, int gpio, int value);
+    static void log(GpioTraceRateLimit *rateLimit, int point, int gpio, int value);
+
+private:
+    GpioTrace() = delete;
+
+    static QAtomicInt s_enabled;
+
+};
+
+// Trace points of the per value paths. They can be removed at compile time with CONFIG+=gpio_no_trace.
+#ifdef NYMEA_GPIO_NO_TRACE
+#define GPIO_TRACE(point, gpio, value) do { } while (0)
+#else
+#define GPIO_TRACE(point, gpio, value) \
+    do { \
+        if (Q_UNLIKELY(GpioTrace::isEnabled())) \
+            GpioTrace::record(point, gpio, value); \
+        if (Q_UNLIKELY(dcGpio().isDebugEnabled())) { \
+            static GpioTraceRateLimit gpioTraceRateLimit; \
+            GpioTrace::log(&gpioTraceRateLimit, point, gpio, value); \
+        } \
+    } while (0)
+#endif
+
+inline bool GpioTrace::isEnabled()
+{
+    return s_enabled.loadAcquire() != 0;
+}
+
+#endif // GPIOTRACE_H
@@ -0,0 +1,255 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioWaveform
+    \brief Plays back a sequence of output values with precise timing.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    Pulse trains for triggering sensors or simple serial protocols need steps in the range of microseconds. Calling
+    Gpio::setValue() in a loop costs a lot more than that and the timing depends on the event loop. A GpioWaveform takes a
+    precomputed list of steps, each consisting of a value and the duration it should be held, and plays it back on a
+    dedicated thread. The value file of the Gpio stays open and the thread waits for absolute deadlines, so the delays
+    of the single steps do not add up. Once all steps have been played, \l{finished()} will be emitted.
+
+    The Gpio has to be exported and configured as output. It must not be used otherwise while the waveform is playing.
+    Using the sysfs backend, the value file stays open during the playback. If the Gpio gets destroyed during the playback,
+    the playback will be aborted.
+
+    \code
+        Gpio *trigger = new Gpio(23, this);
+        trigger->exportGpio();
+        trigger->setDirection(Gpio::DirectionOutput);
+
+        // A 10 us trigger pulse followed by a 60 ms pause
+        GpioWaveform *waveform = new GpioWaveform(trigger, this);
+        waveform->appendStep(Gpio::ValueHigh, 10000);
+        waveform->appendStep(Gpio::ValueLow, 60000000);
+        waveform->setRealtimePriority(50);
+        connect(waveform, &GpioWaveform::finished, this, [waveform](bool completed){
+            qDebug() << "Waveform finished" << completed << "max lateness" << waveform->maxLateness() << "ns";
+        });
+        waveform->play();
+    \endcode
+
+    \sa Gpio, GpioPwm
+*/
+
+/*!
+    \class GpioWaveformStep
+    \brief A step of a \l{GpioWaveform}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The \c value will be written at the beginning of the step and held for the \c duration in nanoseconds.
+*/
+
+/*! \fn void GpioWaveform::finished(bool completed);
+    This signal will be emitted once the playback has ended. \a completed is false if the playback has been stopped before
+    all steps have been played, or if a value could not be written.
+*/
+
+#include "gpiowaveform.h"
+#include "gpiowaveformthread.h"
+
+/*! Constructs a GpioWaveform playing back on the given output \a gpio with the given \a parent. The waveform does not take
+    the ownership of the \a gpio. */
+GpioWaveform::GpioWaveform(Gpio *gpio, QObject *parent) :
+    QObject(parent),
+    m_gpio(gpio)
+{
+    if (m_gpio)
+        connect(m_gpio.data(), &Gpio::destroyed, this, &GpioWaveform::onGpioDestroyed);
+}
+
+/*! Destroys the GpioWaveform and stops a running playback. */
+GpioWaveform::~GpioWaveform()
+{
+    if (!m_thread)
+        return;
+
+    delete m_thread;
+    m_thread = nullptr;
+
+    if (m_gpio)
+        m_gpio->setPersistentValueFile(m_persistentValueFile);
+}
+
+/*! Returns the Gpio this waveform plays back on. */
+Gpio *GpioWaveform::gpio() const
+{
+    return m_gpio;
+}
+
+/*! Returns the steps of this waveform. */
+QVector<GpioWaveformStep> GpioWaveform::steps() const
+{
+    return m_steps;
+}
+
+/*! Sets the \a steps of this waveform. Changing the steps does not affect a running playback. */
+void GpioWaveform::setSteps(const QVector<GpioWaveformStep> &steps)
+{
+    m_steps = steps;
+}
+
+/*! Appends a step writing \a value and holding it for \a duration nanoseconds. Returns false if the \a value is invalid. */
+bool GpioWaveform::appendStep(Gpio::Value value, qint64 duration)
+{
+    if (value == Gpio::ValueInvalid) {
+        qCWarning(dcGpio()) << "GpioWaveform: Appending an invalid value is forbidden.";
+        return false;
+    }
+
+    GpioWaveformStep step;
+    step.value = value;
+    step.duration = qMax<qint64>(duration, 0);
+    m_steps.append(step);
+    return true;
+}
+
+/*! Removes all steps of this waveform. */
+void GpioWaveform::clear()
+{
+    m_steps.clear();
+}
+
+/*! Returns the \tt SCHED_FIFO priority of the playback thread. A priority of 0 means the thread uses the default scheduling policy. */
+int GpioWaveform::realtimePriority() const
+{
+    return m_realtimePriority;
+}
+
+/*! Sets the \tt SCHED_FIFO priority of the playback thread to \a realtimePriority (1 - 99). This applies to playbacks started afterwards. */
+void GpioWaveform::setRealtimePriority(int realtimePriority)
+{
+    m_realtimePriority = realtimePriority;
+}
+
+/*! Returns the CPU the playback thread will be bound to, or -1 if the affinity will not be changed. */
+int GpioWaveform::cpuAffinity() const
+{
+    return m_cpuAffinity;
+}
+
+/*! Binds the playback thread to the CPU \a cpuAffinity. A value of -1 does not change the affinity. This applies to playbacks
+    started afterwards. */
+void GpioWaveform::setCpuAffinity(int cpuAffinity)
+{
+    m_cpuAffinity = cpuAffinity;
+}
+
+/*! Returns true while the waveform is being played back. */
+bool GpioWaveform::isPlaying() const
+{
+    return m_thread != nullptr;
+}
+
+/*! Returns the largest delay in nanoseconds between the deadline of a step and writing its value during the last playback. */
+qint64 GpioWaveform::maxLateness() const
+{
+    return m_maxLateness;
+}
+
+/*! Starts playing back the steps. Returns false if the waveform is already playing or the Gpio is not configured as output, or
+    if a step has an invalid value. */
+bool GpioWaveform::play()
+{
+    if (m_thread) {
+        qCWarning(dcGpio()) << "GpioWaveform: The waveform is already playing.";
+        return false;
+    }
+
+    if (!m_gpio || m_gpio->direction() != Gpio::DirectionOutput) {
+        qCWarning(dcGpio()) << "GpioWaveform: The waveform requires a GPIO configured as output.";
+        return false;
+    }
+
+    foreach (const GpioWaveformStep &step, m_steps) {
+        if (step.value == Gpio::ValueInvalid) {
+            qCWarning(dcGpio()) << "GpioWaveform: The waveform contains an invalid value.";
+            return false;
+        }
+    }
+
+    // Keep the value file open during the playback
+    m_persistentValueFile = m_gpio->persistentValueFile();
+    m_gpio->setPersistentValueFile(true);
+
+    m_thread = new GpioWaveformThread(m_gpio, m_steps);
+    m_thread->setRealtimePriority(m_realtimePriority);
+    m_thread->setCpuAffinity(m_cpuAffinity);
+    connect(m_thread, &QThread::finished, this, &GpioWaveform::onThreadFinished, Qt::QueuedConnection);
+    m_thread->start();
+    return true;
+}
+
+/*! Aborts a running playback. The output keeps the value of the current step. */
+void GpioWaveform::stop()
+{
+    if (!m_thread)
+        return;
+
+    m_thread->stop();
+    onThreadFinished();
+}
+
+void GpioWaveform::onThreadFinished()
+{
+    // A stopped playback has been handled already
+    if (!m_thread || !m_thread->isFinished())
+        return;
+
+    bool completed = m_thread->completed();
+    m_maxLateness = m_thread->maxLateness();
+    delete m_thread;
+    m_thread = nullptr;
+
+    if (m_gpio)
+        m_gpio->setPersistentValueFile(m_persistentValueFile);
+
+    emit finished(completed);
+}
+
+void GpioWaveform::onGpioDestroyed()
+{
+    if (!m_thread)
+        return;
+
+    // The thread must not write to the Gpio any more, there is no setting left to restore
+    qCWarning(dcGpio()) << "GpioWaveform: The GPIO has been destroyed during the playback. Aborting the playback.";
+    m_thread->stop();
+    m_maxLateness = m_thread->maxLateness();
+    delete m_thread;
+    m_thread = nullptr;
+
+    emit finished(false);
+}
@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOWAVEFORM_H
+#define GPIOWAVEFORM_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#include "gpio.h"
+
+class GpioWaveformThread;
+
+struct GpioWaveformStep
+{
+    Gpio::Value value = Gpio::ValueLow;
+    qint64 duration = 0;
+};
+
+class GpioWaveform : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioWaveform(Gpio *gpio, QObject *parent = nullptr);
+    ~GpioWaveform() override;
+
+    Gpio *gpio() const;
+
+    QVector<GpioWaveformStep> steps() const;
+    void setSteps(const QVector<GpioWaveformStep> &steps);
+    bool appendStep(Gpio::Value value, qint64 duration);
+    void clear();
+
+    int realtimePriority() const;
+    void setRealtimePriority(int realtimePriority);
+
+    int cpuAffinity() const;
+    void setCpuAffinity(int cpuAffinity);
+
+    bool isPlaying() const;
+    qint64 maxLateness() const;
+
+public slots:
+    bool play();
+    void stop();
+
+signals:
+    void finished(bool completed);
+
+private:
+    QPointer<Gpio> m_gpio;
+    QVector<GpioWaveformStep> m_steps;
+    int m_realtimePriority = 0;
+    int m_cpuAffinity = -1;
+    qint64 m_maxLateness = 0;
+    bool m_persistentValueFile = false;
+
+    GpioWaveformThread *m_thread = nullptr;
+
+private slots:
+    void onThreadFinished();
+    void onGpioDestroyed();
+
+};
+
+#endif // GPIOWAVEFORM_H
@@ -0,0 +1,177 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*!
+    \class GpioWaveformThread
+    \brief The thread playing back a \l{GpioWaveform}.
+    \inmodule nymea-gpio
+    \ingroup gpio
+
+    The thread writes each step using Gpio::setValue() and waits for the absolute deadline of the next step. Long waits
+    happen on a wait condition, so stopping the playback does not have to wait for the end of a long step. The last
+    milliseconds before a deadline get spent in \tt clock_nanosleep and the last microseconds polling the clock, since
+    waking up from a sleep takes longer than the short steps of a pulse train. The playback fails on the first value which
+    could not be written.
+
+    \sa GpioWaveform
+*/
+
+#include "gpiowaveformthread.h"
+#include "gpiorealtime.h"
+
+// Deadlines closer than this are not waited for on the condition anymore
+static const qint64 wakeupThreshold = 2000000;
+
+// Waits shorter than this get spent polling the clock instead of sleeping
+static const qint64 spinThreshold = 50000;
+
+/*! Constructs the thread playing back the given \a steps on \a gpio. */
+GpioWaveformThread::GpioWaveformThread(Gpio *gpio, const QVector<GpioWaveformStep> &steps) :
+    QThread(),
+    m_gpio(gpio),
+    m_steps(steps)
+{
+    setObjectName("gpio-waveform");
+}
+
+/*! Stops and destroys the thread. */
+GpioWaveformThread::~GpioWaveformThread()
+{
+    stop();
+}
+
+/*! Sets the \tt SCHED_FIFO \a priority of the thread. A priority of 0 keeps the default scheduling policy. */
+void GpioWaveformThread::setRealtimePriority(int priority)
+{
+    m_priority = priority;
+}
+
+/*! Binds the thread to the given \a cpu. A value of -1 does not change the affinity. */
+void GpioWaveformThread::setCpuAffinity(int cpu)
+{
+    m_cpu = cpu;
+}
+
+/*! Starts the playback. */
+void GpioWaveformThread::start()
+{
+    if (isRunning())
+        return;
+
+    m_running.storeRelease(1);
+    QThread::start();
+}
+
+/*! Aborts the playback and waits until the thread has finished. A step ending within the next milliseconds will still be held. */
+void GpioWaveformThread::stop()
+{
+    m_mutex.lock();
+    m_running.storeRelease(0);
+    m_condition.wakeAll();
+    m_mutex.unlock();
+    wait();
+}
+
+/*! Returns true if all steps have been played and written. This is only valid once the thread has finished. */
+bool GpioWaveformThread::completed() const
+{
+    return m_completed;
+}
+
+/*! Returns the largest delay in nanoseconds between the deadline of a step and writing its value. This is only valid once
+    the thread has finished. */
+qint64 GpioWaveformThread::maxLateness() const
+{
+    return m_maxLateness;
+}
+
+void GpioWaveformThread::run()
+{
+    if (m_priority > 0)
+        GpioRealtime::setCurrentThreadPriority(m_priority);
+
+    if (m_cpu >= 0)
+        GpioRealtime::setCurrentThreadAffinity(m_cpu);
+
+    m_completed = false;
+    m_maxLateness = 0;
+
+    const GpioWaveformStep *steps = m_steps.constData();
+    int count = m_steps.count();
+    Gpio::Value value = Gpio::ValueInvalid;
+    qint64 deadline = GpioRealtime::monotonicTime();
+    for (int i = 0; i < count; i++) {
+        if (!m_running.loadAcquire())
+            return;
+
+        qint64 lateness = GpioRealtime::monotonicTime() - deadline;
+        if (lateness > m_maxLateness)
+            m_maxLateness = lateness;
+
+        if (steps[i].value != value) {
+            if (!m_gpio->setValue(steps[i].value)) {
+                qCWarning(dcGpio()) << "GpioWaveform: Could not write step" << i << "of GPIO" << m_gpio->gpioNumber() << ". Aborting the playback.";
+                return;
+            }
+
+            value = steps[i].value;
+        }
+
+        deadline += steps[i].duration;
+        if (!waitUntil(deadline))
+            return;
+    }
+
+    m_completed = true;
+}
+
+// Returns false if the playback has been stopped while waiting
+bool GpioWaveformThread::waitUntil(qint64 deadline)
+{
+    if (deadline - GpioRealtime::monotonicTime() > wakeupThreshold) {
+        QMutexLocker locker(&m_mutex);
+        while (m_running.loadAcquire()) {
+            qint64 remaining = deadline - GpioRealtime::monotonicTime();
+            if (remaining <= wakeupThreshold)
+                break;
+
+            m_condition.wait(&m_mutex, static_cast<unsigned long>((remaining - wakeupThreshold) / 1000000 + 1));
+        }
+
+        if (!m_running.loadAcquire())
+            return false;
+    }
+
+    if (deadline - GpioRealtime::monotonicTime() > spinThreshold)
+        GpioRealtime::sleepUntil(deadline - spinThreshold);
+
+    while (GpioRealtime::monotonicTime() < deadline) { }
+    return true;
+}
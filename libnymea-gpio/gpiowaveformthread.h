@@ -0,0 +1,75 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOWAVEFORMTHREAD_H
+#define GPIOWAVEFORMTHREAD_H
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+
+#include "gpiowaveform.h"
+
+class GpioWaveformThread : public QThread
+{
+public:
+    explicit GpioWaveformThread(Gpio *gpio, const QVector<GpioWaveformStep> &steps);
+    ~GpioWaveformThread() override;
+
+    void setRealtimePriority(int priority);
+    void setCpuAffinity(int cpu);
+
+    void start();
+    void stop();
+
+    bool completed() const;
+    qint64 maxLateness() const;
+
+protected:
+    void run() override;
+
+private:
+    Gpio *m_gpio = nullptr;
+    QVector<GpioWaveformStep> m_steps;
+    QAtomicInt m_running;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    bool m_completed = false;
+    qint64 m_maxLateness = 0;
+
+    int m_priority = 0;
+    int m_cpu = -1;
+
+    bool waitUntil(qint64 deadline);
+
+};
+
+#endif // GPIOWAVEFORMTHREAD_H
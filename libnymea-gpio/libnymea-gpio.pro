@@ -5,13 +5,61 @@ TEMPLATE = lib
 
 HEADERS += \
         gpio.h \
+        gpiobackend.h \
+        gpiobank.h \
         gpiobutton.h \
-        gpiomonitor.h
+        gpiochardevbackend.h \
+        gpiochipinfo.h \
+        gpioconfigurator.h \
+        gpioconfiguratorthread.h \
+        gpioeventqueue.h \
+        gpioeventrecorder.h \
+        gpioeventreplay.h \
+        gpiomockbackend.h \
+        gpiomonitor.h \
+        gpiomonitorpool.h \
+        gpiomonitorthread.h \
+        gpiopwm.h \
+        gpiopwmthread.h \
+        gpiorealtime.h \
+        gpioscanner.h \
+        gpioscheduler.h \
+        gpioschedulerthread.h \
+        gpiostatistics.h \
+        gpiosysfsbackend.h \
+        gpiotimerscheduler.h \
+        gpiotrace.h \
+        gpiowaveform.h \
+        gpiowaveformthread.h
 
 SOURCES += \
         gpio.cpp \
+        gpiobackend.cpp \
+        gpiobank.cpp \
         gpiobutton.cpp \
-        gpiomonitor.cpp
+        gpiochardevbackend.cpp \
+        gpiochipinfo.cpp \
+        gpioconfigurator.cpp \
+        gpioconfiguratorthread.cpp \
+        gpioeventqueue.cpp \
+        gpioeventrecorder.cpp \
+        gpioeventreplay.cpp \
+        gpiomockbackend.cpp \
+        gpiomonitor.cpp \
+        gpiomonitorpool.cpp \
+        gpiomonitorthread.cpp \
+        gpiopwm.cpp \
+        gpiopwmthread.cpp \
+        gpiorealtime.cpp \
+        gpioscanner.cpp \
+        gpioscheduler.cpp \
+        gpioschedulerthread.cpp \
+        gpiostatistics.cpp \
+        gpiosysfsbackend.cpp \
+        gpiotimerscheduler.cpp \
+        gpiotrace.cpp \
+        gpiowaveform.cpp \
+        gpiowaveformthread.cpp
 
 target.path = $$[QT_INSTALL_LIBS]
 INSTALLS += target
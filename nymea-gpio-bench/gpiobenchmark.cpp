@@ -0,0 +1,416 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/*!
+    \class GpioBenchmark
+    \brief Benchmarks for the hot paths of libnymea-gpio.
+
+    The benchmarks measure the value access of a \l{Gpio}, the latency from an edge to the \l{GpioMonitor} signal,
+    the maximal edge rate a \l{GpioMonitor} sustains without dropping events and the overhead of a \l{GpioButton}
+    per edge. Each benchmark runs once per backend.
+
+    The mock backend is always available and generates the edges synthetically. The sysfs and character device
+    backends need real hardware and will be skipped unless it has been configured using environment variables:
+
+    \list
+        \li \tt NYMEA_GPIO_BENCH_OUTPUT: the output GPIO used for the value benchmarks and as edge source.
+        \li \tt NYMEA_GPIO_BENCH_INPUT: the input GPIO for the edge benchmarks. This GPIO has to be wired to the
+            output GPIO, which toggles it using a software \l{GpioPwm}.
+    \endlist
+
+    \code
+        $ NYMEA_GPIO_BENCH_OUTPUT=20 NYMEA_GPIO_BENCH_INPUT=21 nymea-gpio-bench edgeLatency
+    \endcode
+*/
+
+#include "gpiobenchmark.h"
+#include "gpio.h"
+#include "gpiopwm.h"
+#include "gpiobutton.h"
+#include "gpiomonitor.h"
+#include "gpiorealtime.h"
+#include "gpiomockbackend.h"
+#include "gpiosysfsbackend.h"
+#include "gpiochardevbackend.h"
+
+#include <QtTest>
+#include <QLoggingCategory>
+
+#include <time.h>
+#include <algorithm>
+
+static const int mockOutputGpio = 1000;
+static const int mockInputGpio = 1001;
+
+GpioBenchmark::GpioBenchmark(QObject *parent) :
+    QObject(parent)
+{
+    // Debug output for every edge would be the dominating cost of each benchmark
+    QLoggingCategory::setFilterRules("Gpio.debug=false");
+}
+
+void GpioBenchmark::addBackendRows()
+{
+    QTest::addColumn<QString>("backend");
+
+    QTest::newRow("sysfs") << "sysfs";
+    QTest::newRow("chardev") << "chardev";
+    QTest::newRow("mock") << "mock";
+}
+
+bool GpioBenchmark::selectBackend(const QString &backend, QString *reason)
+{
+    qputenv("NYMEA_GPIO_BACKEND", backend.toLatin1());
+
+    if (backend == "mock") {
+        m_outputGpio = mockOutputGpio;
+        m_inputGpio = mockInputGpio;
+        m_loopback = false;
+        return true;
+    }
+
+    if (backend == "sysfs" && !GpioSysfsBackend::isAvailable()) {
+        *reason = "The sysfs GPIO interface is not available on this system.";
+        return false;
+    }
+
+    if (backend == "chardev" && !GpioChardevBackend::isAvailable()) {
+        *reason = "The GPIO character device interface is not available on this system.";
+        return false;
+    }
+
+    bool outputOk = false;
+    m_outputGpio = qEnvironmentVariableIntValue("NYMEA_GPIO_BENCH_OUTPUT", &outputOk);
+    if (!outputOk) {
+        *reason = "No output GPIO configured. Set NYMEA_GPIO_BENCH_OUTPUT in order to run the hardware benchmarks.";
+        m_outputGpio = -1;
+        return false;
+    }
+
+    bool inputOk = false;
+    m_inputGpio = qEnvironmentVariableIntValue("NYMEA_GPIO_BENCH_INPUT", &inputOk);
+    if (!inputOk)
+        m_inputGpio = -1;
+
+    m_loopback = true;
+    return true;
+}
+
+bool GpioBenchmark::startEdges(double frequency)
+{
+    if (!m_loopback)
+        return GpioMockBackend::startEdgeGenerator(m_inputGpio, frequency);
+
+    // One period of the PWM produces two edges on the wired input
+    m_edgeSource = new GpioPwm(m_outputGpio, this);
+    m_edgeSource->setPeriod(qRound64(2000000000.0 / frequency));
+    m_edgeSource->setDutyCycle(0.5);
+    return m_edgeSource->enable();
+}
+
+void GpioBenchmark::stopEdges()
+{
+    if (!m_loopback) {
+        if (m_inputGpio >= 0)
+            GpioMockBackend::stopEdgeGenerator(m_inputGpio);
+
+        return;
+    }
+
+    if (m_edgeSource) {
+        m_edgeSource->disable();
+        delete m_edgeSource;
+        m_edgeSource = nullptr;
+    }
+}
+
+qint64 GpioBenchmark::threadCpuTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<qint64>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+qint64 GpioBenchmark::percentile(const QVector<qint64> &sortedSamples, double percentile)
+{
+    if (sortedSamples.isEmpty())
+        return 0;
+
+    int index = qBound(0, static_cast<int>(percentile * sortedSamples.count()), sortedSamples.count() - 1);
+    return sortedSamples.at(index);
+}
+
+void GpioBenchmark::cleanup()
+{
+    stopEdges();
+    qunsetenv("NYMEA_GPIO_BACKEND");
+}
+
+void GpioBenchmark::setValue_data()
+{
+    addBackendRows();
+}
+
+void GpioBenchmark::setValue()
+{
+    QFETCH(QString, backend);
+
+    QString reason;
+    if (!selectBackend(backend, &reason))
+        QSKIP(qPrintable(reason));
+
+    Gpio gpio(m_outputGpio);
+    QVERIFY(gpio.exportGpio());
+    QVERIFY(gpio.setDirection(Gpio::DirectionOutput));
+
+    // Toggle the value, every write has to reach the backend
+    gpio.setWriteElision(false);
+    bool high = false;
+    QBENCHMARK {
+        high = !high;
+        gpio.setValue(high ? Gpio::ValueHigh : Gpio::ValueLow);
+    }
+
+    gpio.setValue(Gpio::ValueLow);
+    gpio.unexportGpio();
+}
+
+void GpioBenchmark::value_data()
+{
+    addBackendRows();
+}
+
+void GpioBenchmark::value()
+{
+    QFETCH(QString, backend);
+
+    QString reason;
+    if (!selectBackend(backend, &reason))
+        QSKIP(qPrintable(reason));
+
+    Gpio gpio(m_outputGpio);
+    QVERIFY(gpio.exportGpio());
+    QVERIFY(gpio.setDirection(Gpio::DirectionOutput));
+    QVERIFY(gpio.setValue(Gpio::ValueLow));
+
+    QBENCHMARK {
+        gpio.value();
+    }
+
+    gpio.unexportGpio();
+}
+
+void GpioBenchmark::edgeLatency_data()
+{
+    QTest::addColumn<QString>("backend");
+    QTest::addColumn<bool>("realtimeThread");
+
+    foreach (const QString &backend, QStringList() << "sysfs" << "chardev" << "mock") {
+        QTest::newRow(qPrintable(backend + "-eventloop")) << backend << false;
+        QTest::newRow(qPrintable(backend + "-thread")) << backend << true;
+    }
+}
+
+void GpioBenchmark::edgeLatency()
+{
+    QFETCH(QString, backend);
+    QFETCH(bool, realtimeThread);
+
+    QString reason;
+    if (!selectBackend(backend, &reason))
+        QSKIP(qPrintable(reason));
+
+    if (m_inputGpio < 0)
+        QSKIP("No input GPIO configured. Set NYMEA_GPIO_BENCH_INPUT to a GPIO wired to NYMEA_GPIO_BENCH_OUTPUT.");
+
+    // The latency is measured from the timestamp of the event to the emission of the signal. The sysfs
+    // backend takes the timestamp when reading the event, so only the delivery of the event will be covered.
+    const int sampleCount = 2000;
+    QVector<qint64> latencies;
+    latencies.reserve(sampleCount);
+
+    GpioMonitor monitor(m_inputGpio);
+    monitor.setRealtimeThreadEnabled(realtimeThread);
+    connect(&monitor, &GpioMonitor::edgeEvent, this, [&latencies, sampleCount](bool value, qint64 timestamp, quint32 sequence) {
+        Q_UNUSED(value)
+        Q_UNUSED(sequence)
+        if (latencies.count() < sampleCount) {
+            latencies.append(GpioRealtime::monotonicTime() - timestamp);
+        }
+    });
+
+    QVERIFY(monitor.enable());
+    QVERIFY(startEdges(1000));
+    QTRY_VERIFY_WITH_TIMEOUT(latencies.count() >= sampleCount, 10000);
+    stopEdges();
+    monitor.disable();
+
+    std::sort(latencies.begin(), latencies.end());
+    qInfo().nospace() << "Edge latency " << QTest::currentDataTag() << " [ns]:"
+                      << " p50 " << percentile(latencies, 0.5)
+                      << " p90 " << percentile(latencies, 0.9)
+                      << " p99 " << percentile(latencies, 0.99)
+                      << " p99.9 " << percentile(latencies, 0.999)
+                      << " max " << latencies.last();
+
+    QTest::setBenchmarkResult(percentile(latencies, 0.5), QTest::WalltimeNanoseconds);
+}
+
+void GpioBenchmark::maxEdgeRate_data()
+{
+    addBackendRows();
+}
+
+void GpioBenchmark::maxEdgeRate()
+{
+    QFETCH(QString, backend);
+
+    QString reason;
+    if (!selectBackend(backend, &reason))
+        QSKIP(qPrintable(reason));
+
+    if (m_inputGpio < 0)
+        QSKIP("No input GPIO configured. Set NYMEA_GPIO_BENCH_INPUT to a GPIO wired to NYMEA_GPIO_BENCH_OUTPUT.");
+
+    GpioMonitor monitor(m_inputGpio);
+    monitor.setDeliveryMode(GpioMonitor::DeliveryModeQueued);
+    monitor.setRealtimeThreadEnabled(true);
+
+    quint64 received = 0;
+    connect(&monitor, &GpioMonitor::eventsQueued, this, [&monitor, &received](int count) {
+        Q_UNUSED(count)
+        GpioEvent events[256];
+        int taken = 0;
+        while ((taken = monitor.takeEvents(events, 256)) > 0) {
+            received += static_cast<quint64>(taken);
+        }
+    });
+
+    QVERIFY(monitor.enable());
+
+    // Increase the edge rate until the monitor starts loosing events
+    const int window = 500;
+    double sustainedRate = 0;
+    foreach (double rate, QList<double>() << 1000 << 2000 << 5000 << 10000 << 20000 << 50000 << 100000 << 200000) {
+        received = 0;
+        quint64 droppedEvents = monitor.droppedEvents();
+        quint64 generatedEdges = m_loopback ? 0 : GpioMockBackend::generatedEdges(m_inputGpio);
+
+        QVERIFY(startEdges(rate));
+        QTest::qWait(window);
+        stopEdges();
+
+        // Let the monitor drain the remaining events
+        QTest::qWait(50);
+
+        double expected = m_loopback ? rate * window / 1000 : GpioMockBackend::generatedEdges(m_inputGpio) - generatedEdges;
+        quint64 dropped = monitor.droppedEvents() - droppedEvents;
+        qInfo().nospace() << "Edge rate " << rate << "/s: expected " << qRound64(expected)
+                          << " received " << received << " dropped " << dropped;
+
+        if (dropped > 0 || received < expected * 0.95)
+            break;
+
+        sustainedRate = rate;
+    }
+
+    monitor.disable();
+
+    qInfo().nospace() << "Maximal sustained edge rate " << QTest::currentDataTag() << ": " << sustainedRate << "/s";
+    QTest::setBenchmarkResult(sustainedRate, QTest::Events);
+}
+
+void GpioBenchmark::buttonOverhead_data()
+{
+    addBackendRows();
+}
+
+void GpioBenchmark::buttonOverhead()
+{
+    QFETCH(QString, backend);
+
+    QString reason;
+    if (!selectBackend(backend, &reason))
+        QSKIP(qPrintable(reason));
+
+    if (m_inputGpio < 0)
+        QSKIP("No input GPIO configured. Set NYMEA_GPIO_BENCH_INPUT to a GPIO wired to NYMEA_GPIO_BENCH_OUTPUT.");
+
+    // Compare the CPU time of this thread per edge for a bare monitor and for a button
+    // on top of it, the difference is the cost of the button state machine.
+    const double rate = 1000;
+    const int window = 1000;
+
+    quint64 monitorEdges = 0;
+    qint64 monitorTime = 0;
+    {
+        GpioMonitor monitor(m_inputGpio);
+        connect(&monitor, &GpioMonitor::valueChanged, this, [&monitorEdges](bool value) {
+            Q_UNUSED(value)
+            monitorEdges++;
+        });
+
+        QVERIFY(monitor.enable());
+        qint64 startTime = threadCpuTime();
+        QVERIFY(startEdges(rate));
+        QTest::qWait(window);
+        stopEdges();
+        monitorTime = threadCpuTime() - startTime;
+        monitor.disable();
+    }
+
+    quint64 buttonEdges = 0;
+    qint64 buttonTime = 0;
+    {
+        GpioButton button(m_inputGpio);
+        button.setDebounceInterval(0);
+        connect(&button, &GpioButton::pressed, this, [&buttonEdges]() { buttonEdges++; });
+        connect(&button, &GpioButton::released, this, [&buttonEdges]() { buttonEdges++; });
+
+        QVERIFY(button.enable());
+        qint64 startTime = threadCpuTime();
+        QVERIFY(startEdges(rate));
+        QTest::qWait(window);
+        stopEdges();
+        buttonTime = threadCpuTime() - startTime;
+        button.disable();
+    }
+
+    QVERIFY(monitorEdges > 0);
+    QVERIFY(buttonEdges > 0);
+
+    double monitorCost = static_cast<double>(monitorTime) / monitorEdges;
+    double buttonCost = static_cast<double>(buttonTime) / buttonEdges;
+    qInfo().nospace() << "CPU time per edge " << QTest::currentDataTag() << " [ns]: monitor " << qRound64(monitorCost)
+                      << " button " << qRound64(buttonCost) << " overhead " << qRound64(buttonCost - monitorCost);
+
+    QTest::setBenchmarkResult(qMax(buttonCost - monitorCost, 0.0), QTest::WalltimeNanoseconds);
+}
+
+QTEST_GUILESS_MAIN(GpioBenchmark)
@@ -0,0 +1,80 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef GPIOBENCHMARK_H
+#define GPIOBENCHMARK_H
+
+#include <QObject>
+#include <QVector>
+
+class GpioPwm;
+
+class GpioBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioBenchmark(QObject *parent = nullptr);
+
+private:
+    int m_outputGpio = -1;
+    int m_inputGpio = -1;
+    bool m_loopback = false;
+    GpioPwm *m_edgeSource = nullptr;
+
+    void addBackendRows();
+    bool selectBackend(const QString &backend, QString *reason);
+
+    bool startEdges(double frequency);
+    void stopEdges();
+
+    static qint64 threadCpuTime();
+    static qint64 percentile(const QVector<qint64> &sortedSamples, double percentile);
+
+private slots:
+    void cleanup();
+
+    void setValue_data();
+    void setValue();
+
+    void value_data();
+    void value();
+
+    void edgeLatency_data();
+    void edgeLatency();
+
+    void maxEdgeRate_data();
+    void maxEdgeRate();
+
+    void buttonOverhead_data();
+    void buttonOverhead();
+
+};
+
+#endif // GPIOBENCHMARK_H
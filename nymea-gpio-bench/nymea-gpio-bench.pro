@@ -0,0 +1,17 @@
+include(../nymea-gpio.pri)
+
+TARGET = nymea-gpio-bench
+
+QT += testlib
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += $$top_srcdir/libnymea-gpio/
+LIBS += -L$$top_builddir/libnymea-gpio/ -lnymea-gpio
+
+HEADERS += \
+    gpiobenchmark.h
+
+SOURCES += \
+    gpiobenchmark.cpp
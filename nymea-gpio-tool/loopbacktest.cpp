@@ -0,0 +1,149 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "loopbacktest.h"
+#include "gpiorealtime.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+static qint64 percentile(const QVector<qint64> &sortedValues, double percentile)
+{
+    int index = qMin(sortedValues.count() - 1, static_cast<int>(percentile * sortedValues.count()));
+    return sortedValues.at(index);
+}
+
+LoopbackTest::LoopbackTest(int outputGpio, int inputGpio, int count, QObject *parent) :
+    QObject(parent),
+    m_count(count)
+{
+    m_output = new Gpio(outputGpio, this);
+    m_monitor = new GpioMonitor(inputGpio, this);
+    connect(m_monitor, &GpioMonitor::edgeEvent, this, &LoopbackTest::onEdgeEvent);
+
+    // An edge which did not arrive within a second is considered lost
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setSingleShot(true);
+    m_timeoutTimer->setInterval(1000);
+    connect(m_timeoutTimer, &QTimer::timeout, this, &LoopbackTest::onTimeout);
+
+    m_latencies.reserve(m_count);
+}
+
+Gpio *LoopbackTest::output() const
+{
+    return m_output;
+}
+
+GpioMonitor *LoopbackTest::monitor() const
+{
+    return m_monitor;
+}
+
+bool LoopbackTest::start()
+{
+    if (!m_output->exportGpio() || !m_output->setDirection(Gpio::DirectionOutput) || !m_output->setValue(Gpio::ValueLow)) {
+        qCritical() << "Could not configure GPIO" << m_output->gpioNumber() << "as output.";
+        return false;
+    }
+
+    if (!m_monitor->enable(false, Gpio::EdgeBoth)) {
+        qCritical() << "Could not enable GPIO" << m_monitor->gpioNumber() << "monitor.";
+        return false;
+    }
+
+    if (m_monitor->value()) {
+        qCritical() << "The input GPIO" << m_monitor->gpioNumber() << "does not follow the output GPIO" << m_output->gpioNumber() << ". Please check the wiring.";
+        return false;
+    }
+
+    qDebug() << "Measuring" << m_count << "round trips from GPIO" << m_output->gpioNumber() << "to GPIO" << m_monitor->gpioNumber();
+    toggle();
+    return true;
+}
+
+void LoopbackTest::toggle()
+{
+    m_value = !m_value;
+    m_toggleTime = GpioRealtime::monotonicTime();
+    m_output->setValue(m_value ? Gpio::ValueHigh : Gpio::ValueLow);
+    m_timeoutTimer->start();
+}
+
+void LoopbackTest::printResult()
+{
+    if (m_latencies.isEmpty()) {
+        qCritical() << "No edge arrived on GPIO" << m_monitor->gpioNumber() << ". Please check the wiring.";
+        return;
+    }
+
+    std::sort(m_latencies.begin(), m_latencies.end());
+    qDebug().nospace() << "Round trip latency [us]:"
+                       << " p50 " << percentile(m_latencies, 0.5) / 1000.0
+                       << " p90 " << percentile(m_latencies, 0.9) / 1000.0
+                       << " p99 " << percentile(m_latencies, 0.99) / 1000.0
+                       << " p99.9 " << percentile(m_latencies, 0.999) / 1000.0
+                       << " max " << m_latencies.last() / 1000.0
+                       << " lost edges " << m_lostEdges;
+}
+
+void LoopbackTest::onEdgeEvent(bool value, qint64 timestamp, quint32 sequence)
+{
+    Q_UNUSED(timestamp)
+    Q_UNUSED(sequence)
+
+    // Ignore edges which do not belong to the current toggle, i.e. late edges after a timeout
+    if (value != m_value || !m_timeoutTimer->isActive())
+        return;
+
+    m_timeoutTimer->stop();
+    m_latencies.append(GpioRealtime::monotonicTime() - m_toggleTime);
+    if (m_latencies.count() + m_lostEdges >= m_count) {
+        printResult();
+        emit finished();
+        return;
+    }
+
+    toggle();
+}
+
+void LoopbackTest::onTimeout()
+{
+    qWarning() << "Lost the edge" << (m_value ? "1" : "0") << "on GPIO" << m_monitor->gpioNumber();
+    m_lostEdges++;
+    if (m_latencies.count() + m_lostEdges >= m_count) {
+        printResult();
+        emit finished();
+        return;
+    }
+
+    toggle();
+}
@@ -0,0 +1,75 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef LOOPBACKTEST_H
+#define LOOPBACKTEST_H
+
+#include <QTimer>
+#include <QObject>
+#include <QVector>
+
+#include "gpio.h"
+#include "gpiomonitor.h"
+
+class LoopbackTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoopbackTest(int outputGpio, int inputGpio, int count, QObject *parent = nullptr);
+
+    Gpio *output() const;
+    GpioMonitor *monitor() const;
+
+    bool start();
+
+signals:
+    void finished();
+
+private:
+    Gpio *m_output = nullptr;
+    GpioMonitor *m_monitor = nullptr;
+    QTimer *m_timeoutTimer = nullptr;
+
+    int m_count = 0;
+    int m_lostEdges = 0;
+    bool m_value = false;
+    qint64 m_toggleTime = 0;
+    QVector<qint64> m_latencies;
+
+    void toggle();
+    void printResult();
+
+private slots:
+    void onEdgeEvent(bool value, qint64 timestamp, quint32 sequence);
+    void onTimeout();
+
+};
+
+#endif // LOOPBACKTEST_H
@@ -28,10 +28,57 @@
 *
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QCommandLineParser>
 
 #include "application.h"
 #include "gpiomonitor.h"
+#include "gpiochipinfo.h"
+#include "loopbacktest.h"
+
+// A GPIO can be given by its number or by the name of its line
+static bool parseGpio(const QString &gpioString, int *gpioNumber)
+{
+    bool gpioNumberOk;
+    *gpioNumber = gpioString.toInt(&gpioNumberOk);
+    if (gpioNumberOk)
+        return *gpioNumber >= 0;
+
+    *gpioNumber = GpioChipInfo::gpioNumber(gpioString);
+    return *gpioNumber >= 0;
+}
+
+static int benchmark(const QList<int> &gpioNumbers, int count, bool printStatistics)
+{
+    foreach (int gpioNumber, gpioNumbers) {
+        Gpio gpio(gpioNumber);
+        if (!gpio.exportGpio() || !gpio.setDirection(Gpio::DirectionOutput)) {
+            qCritical() << "Could not configure GPIO" << gpioNumber << "as output.";
+            return EXIT_FAILURE;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; i++) {
+            if (!gpio.setValue(i % 2 == 0 ? Gpio::ValueHigh : Gpio::ValueLow)) {
+                qCritical() << "Could not set GPIO" << gpioNumber << "value.";
+                return EXIT_FAILURE;
+            }
+        }
+        qint64 duration = qMax(timer.nsecsElapsed(), static_cast<qint64>(1));
+
+        qDebug().nospace() << "GPIO " << gpioNumber << " (" << gpio.backendType() << "): " << count << " writes, "
+                           << qRound64(count * 1000000000.0 / duration) << " ops/s, "
+                           << duration / count << " ns per write";
+
+        if (printStatistics)
+            qDebug() << gpio.statistics();
+    }
+
+    return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[])
 {
@@ -49,7 +96,7 @@ int main(int argc, char *argv[])
                                              "Released under the GNU GENERAL PUBLIC LICENSE Version 3.\n").arg(application.applicationVersion()).arg(QChar(0xA9));
     parser.setApplicationDescription(applicationDescription);
 
-    QCommandLineOption gpioOption(QStringList() << "g" << "gpio", "The gpio number to use.", "GPIO");
+    QCommandLineOption gpioOption(QStringList() << "g" << "gpio", "The gpio number or line name to use. This option can be passed multiple times in order to use several GPIOs.", "GPIO");
     parser.addOption(gpioOption);
 
     QCommandLineOption interruptOption(QStringList() << "i" << "interrupt", "Configure the input GPIO to the given interrupt. This option is only allowed for monitoring. Allowerd interrupts are: [rising, falling, both, none]. Default is \"both\".", "INTERRUPT");
@@ -64,20 +111,54 @@ int main(int argc, char *argv[])
     QCommandLineOption activeLowOption(QStringList() << "l" << "active-low", "Configure the pin as active low (default is active high).");
     parser.addOption(activeLowOption);
 
+    QCommandLineOption statisticsOption(QStringList() << "t" << "statistics" << "stats", "Print the access and edge statistics of the GPIO every INTERVAL seconds while monitoring, or once after setting the value, the benchmark or the loopback test.", "INTERVAL");
+    parser.addOption(statisticsOption);
+
+    QCommandLineOption benchOption(QStringList() << "b" << "bench", "Configure the given GPIOs as output and toggle them in a tight loop. Prints the write rate of each GPIO.");
+    parser.addOption(benchOption);
+
+    QCommandLineOption loopbackOption(QStringList() << "loopback", "Measure the round trip latency from setting the output GPIO OUT until the edge on the wired input GPIO IN has been delivered.", "OUT,IN");
+    parser.addOption(loopbackOption);
+
+    QCommandLineOption countOption(QStringList() << "c" << "count", "The number of writes of the benchmark or round trips of the loopback test. Default is 1000.", "COUNT");
+    parser.addOption(countOption);
+
     parser.process(application);
 
+    // Verify the loopback GPIOs
+    QList<int> loopbackGpios;
+    if (parser.isSet(loopbackOption)) {
+        QStringList loopbackStrings = parser.value(loopbackOption).split(',');
+        foreach (const QString &loopbackString, loopbackStrings) {
+            int gpioNumber = -1;
+            if (!parseGpio(loopbackString.trimmed(), &gpioNumber)) {
+                qCritical() << "Invalid GPIO" << loopbackString << "passed. The GPIO has to be a positiv integer or the name of a GPIO line.";
+                return EXIT_FAILURE;
+            }
+            loopbackGpios.append(gpioNumber);
+        }
+
+        if (loopbackGpios.count() != 2) {
+            qCritical() << "Invalid loopback parameter" << parser.value(loopbackOption) << "passed. Please specify the output and input GPIO using --loopback OUT,IN";
+            return EXIT_FAILURE;
+        }
+    }
+
     // Make sure there is a GPIO number passed
-    if (!parser.isSet(gpioOption)) {
+    if (!parser.isSet(gpioOption) && !parser.isSet(loopbackOption)) {
         qCritical() << "No GPIO number specified. Please specify a valid GPIO number using -g, --gpio GPIO";
         parser.showHelp(EXIT_FAILURE);
     }
 
-    // Verify GPIO number
-    bool gpioNumberOk;
-    int gpioNumber = parser.value(gpioOption).toInt(&gpioNumberOk);
-    if (!gpioNumberOk || gpioNumber < 0) {
-        qCritical() << "Invalid GPIO number" << parser.value(gpioOption) << "passed. The GPIO number has to be a positiv integer.";
-        return EXIT_FAILURE;
+    // Verify GPIO numbers
+    QList<int> gpioNumbers;
+    foreach (const QString &gpioString, parser.values(gpioOption)) {
+        int gpioNumber = -1;
+        if (!parseGpio(gpioString, &gpioNumber)) {
+            qCritical() << "Invalid GPIO" << gpioString << "passed. The GPIO has to be a positiv integer or the name of a GPIO line.";
+            return EXIT_FAILURE;
+        }
+        gpioNumbers.append(gpioNumber);
     }
 
     // Verify input output operations
@@ -86,6 +167,17 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    int modeCount = 0;
+    foreach (const QCommandLineOption &modeOption, QList<QCommandLineOption>() << valueOption << monitorOption << benchOption << loopbackOption) {
+        if (parser.isSet(modeOption))
+            modeCount++;
+    }
+
+    if (modeCount > 1) {
+        qCritical() << "Invalid parameter combination. Only one of set value, monitor, bench and loopback can be used at the same time.";
+        return EXIT_FAILURE;
+    }
+
     Gpio::Edge edge = Gpio::EdgeBoth;
     if (parser.isSet(interruptOption)) {
         if (parser.value(interruptOption).toLower() == "rising") {
@@ -116,40 +208,91 @@ int main(int argc, char *argv[])
         }
     }
 
+    int statisticsInterval = 0;
+    if (parser.isSet(statisticsOption)) {
+        bool statisticsIntervalOk;
+        statisticsInterval = parser.value(statisticsOption).toInt(&statisticsIntervalOk);
+        if (!statisticsIntervalOk || statisticsInterval <= 0) {
+            qCritical() << "Invalid statistics interval" << parser.value(statisticsOption) << "passed. The interval has to be a positiv number of seconds.";
+            return EXIT_FAILURE;
+        }
+    }
+
+    int count = 1000;
+    if (parser.isSet(countOption)) {
+        bool countOk;
+        count = parser.value(countOption).toInt(&countOk);
+        if (!countOk || count <= 0) {
+            qCritical() << "Invalid count" << parser.value(countOption) << "passed. The count has to be a positiv integer.";
+            return EXIT_FAILURE;
+        }
+    }
+
     if (!Gpio::isAvailable()) {
         qCritical() << "There are no GPIOs available on this platform.";
         return EXIT_FAILURE;
     }
 
-    // Configure the GPIO
-    if (parser.isSet(valueOption)) {
-        Gpio *gpio = new Gpio(gpioNumber);
-        if (!gpio->exportGpio()) {
-            qCritical() << "Could not export GPIO" << gpioNumber;
-            return EXIT_FAILURE;
-        }
+    if (parser.isSet(benchOption))
+        return benchmark(gpioNumbers, count, statisticsInterval > 0);
 
-        if (!gpio->setDirection(Gpio::DirectionOutput)) {
-            qCritical() << "Could not configure GPIO" << gpioNumber << "as output.";
+    if (parser.isSet(loopbackOption)) {
+        LoopbackTest *loopbackTest = new LoopbackTest(loopbackGpios.at(0), loopbackGpios.at(1), count);
+        QObject::connect(loopbackTest, &LoopbackTest::finished, [loopbackTest, statisticsInterval](){
+            if (statisticsInterval > 0) {
+                qDebug() << loopbackTest->output()->statistics();
+                qDebug() << loopbackTest->monitor()->statistics();
+            }
+            Application::quit();
+        });
+
+        if (!loopbackTest->start())
             return EXIT_FAILURE;
-        }
 
-        if (parser.isSet(activeLowOption)) {
-            if (!gpio->setActiveLow(activeLow)) {
-                qCritical() << "Could not set GPIO" << gpioNumber << "to active low" << activeLow;
+        // Clean up the gpios once done
+        QObject::connect(&application, &Application::aboutToQuit, [loopbackTest](){
+            delete loopbackTest;
+        });
+
+        return application.exec();
+    }
+
+    // Configure the GPIOs
+    if (parser.isSet(valueOption)) {
+        foreach (int gpioNumber, gpioNumbers) {
+            Gpio gpio(gpioNumber);
+            if (!gpio.exportGpio()) {
+                qCritical() << "Could not export GPIO" << gpioNumber;
                 return EXIT_FAILURE;
             }
-        }
 
-        // Finally set the value
-        if (!gpio->setValue(value)) {
-            qCritical() << "Could not set GPIO" << gpioNumber << "value to" << value;
-            return EXIT_FAILURE;
+            if (!gpio.setDirection(Gpio::DirectionOutput)) {
+                qCritical() << "Could not configure GPIO" << gpioNumber << "as output.";
+                return EXIT_FAILURE;
+            }
+
+            if (parser.isSet(activeLowOption)) {
+                if (!gpio.setActiveLow(activeLow)) {
+                    qCritical() << "Could not set GPIO" << gpioNumber << "to active low" << activeLow;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            // Finally set the value
+            if (!gpio.setValue(value)) {
+                qCritical() << "Could not set GPIO" << gpioNumber << "value to" << value;
+                return EXIT_FAILURE;
+            }
+
+            if (statisticsInterval > 0)
+                qDebug() << gpio.statistics();
         }
 
-        delete gpio;
         return EXIT_SUCCESS;
-    } else {
+    }
+
+    QList<GpioMonitor *> monitors;
+    foreach (int gpioNumber, gpioNumbers) {
         GpioMonitor *monitor = new GpioMonitor(gpioNumber);
 
         // Inform about interrupt
@@ -163,11 +306,24 @@ int main(int argc, char *argv[])
             return EXIT_FAILURE;
         }
 
-        // Clean up the gpio once done
-        QObject::connect(&application, &Application::aboutToQuit, [monitor](){
-            delete monitor;
+        monitors.append(monitor);
+    }
+
+    // Print the statistics periodically
+    if (statisticsInterval > 0) {
+        QTimer *statisticsTimer = new QTimer(&application);
+        QObject::connect(statisticsTimer, &QTimer::timeout, [monitors](){
+            foreach (GpioMonitor *monitor, monitors) {
+                qDebug() << monitor->statistics();
+            }
         });
+        statisticsTimer->start(statisticsInterval * 1000);
     }
 
+    // Clean up the gpios once done
+    QObject::connect(&application, &Application::aboutToQuit, [monitors](){
+        qDeleteAll(monitors);
+    });
+
     return application.exec();
 }
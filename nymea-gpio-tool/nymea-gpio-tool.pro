@@ -10,10 +10,12 @@ INCLUDEPATH += $$top_srcdir/libnymea-gpio/
 LIBS += -L$$top_builddir/libnymea-gpio/ -lnymea-gpio
 
 HEADERS += \
-    application.h
+    application.h \
+    loopbacktest.h
 
 SOURCES += main.cpp \
-    application.cpp
+    application.cpp \
+    loopbacktest.cpp
 
 target.path = $$[QT_INSTALL_PREFIX]/bin
 INSTALLS += target
@@ -10,6 +10,11 @@ gcc {
 
 QT -= gui
 
+# Remove the trace points of the per value paths: qmake CONFIG+=gpio_no_trace
+gpio_no_trace {
+    DEFINES += NYMEA_GPIO_NO_TRACE
+}
+
 top_srcdir=$$PWD
 top_builddir=$$shadowed($$PWD)
 
@@ -1,4 +1,5 @@
 TEMPLATE = subdirs
-SUBDIRS = libnymea-gpio nymea-gpio-tool
+SUBDIRS = libnymea-gpio nymea-gpio-tool nymea-gpio-bench tests
 nymea-gpio-tool.depends = libnymea-gpio
-
+nymea-gpio-bench.depends = libnymea-gpio
+tests.depends = libnymea-gpio
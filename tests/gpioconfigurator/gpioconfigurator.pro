@@ -0,0 +1,18 @@
+include(../../nymea-gpio.pri)
+
+TARGET = gpioconfiguratortest
+
+QT += testlib
+CONFIG += console testcase no_testcase_installs
+CONFIG -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += $$top_srcdir/libnymea-gpio/
+LIBS += -L$$top_builddir/libnymea-gpio/ -lnymea-gpio
+QMAKE_RPATHDIR += $$top_builddir/libnymea-gpio/
+
+HEADERS += \
+    gpioconfiguratortest.h
+
+SOURCES += \
+    gpioconfiguratortest.cpp
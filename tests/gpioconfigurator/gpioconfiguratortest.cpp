@@ -0,0 +1,173 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+    Tests the GpioConfigurator against a fake sysfs tree. The export file of the fake tree is a FIFO read by the test,
+    which only creates the GPIO directories once all GPIOs have been exported, just like a slow udev would. Only the
+    pipelined export of the configurator can configure the GPIOs in time, exporting them one after the other runs into
+    the export timeout for each of them.
+*/
+
+#include "gpioconfiguratortest.h"
+#include "gpioconfigurator.h"
+
+#include <QtTest>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// The GPIO numbers of the test have 4 digits, which separates the exports written into the FIFO
+static const int gpioNumberWidth = 4;
+static const int firstGpio = 1000;
+static const int gpioCount = 4;
+
+GpioConfiguratorTest::GpioConfiguratorTest(QObject *parent) :
+    QObject(parent)
+{
+
+}
+
+void GpioConfiguratorTest::initTestCase()
+{
+    QVERIFY(m_sysfsDirectory.isValid());
+
+    QByteArray exportPath = QString(m_sysfsDirectory.path() + "/export").toLocal8Bit();
+    QVERIFY(mkfifo(exportPath.constData(), 0600) == 0);
+
+    QFile unexportFile(m_sysfsDirectory.path() + "/unexport");
+    QVERIFY(unexportFile.open(QIODevice::WriteOnly));
+    unexportFile.close();
+
+    // Keep a writer open, otherwise the FIFO reports a hang up between the exports
+    m_exportFd = ::open(exportPath.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    QVERIFY(m_exportFd >= 0);
+    m_exportKeepAliveFd = ::open(exportPath.constData(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    QVERIFY(m_exportKeepAliveFd >= 0);
+
+    m_exportNotifier = new QSocketNotifier(m_exportFd, QSocketNotifier::Read, this);
+    connect(m_exportNotifier, &QSocketNotifier::activated, this, &GpioConfiguratorTest::onExportWritten);
+
+    qputenv("NYMEA_GPIO_SYSFS_PATH", m_sysfsDirectory.path().toLocal8Bit());
+    qputenv("NYMEA_GPIO_BACKEND", "sysfs");
+}
+
+void GpioConfiguratorTest::cleanupTestCase()
+{
+    delete m_exportNotifier;
+    m_exportNotifier = nullptr;
+
+    ::close(m_exportKeepAliveFd);
+    ::close(m_exportFd);
+
+    qunsetenv("NYMEA_GPIO_SYSFS_PATH");
+    qunsetenv("NYMEA_GPIO_BACKEND");
+}
+
+void GpioConfiguratorTest::onExportWritten()
+{
+    char buffer[64];
+    ssize_t size = 0;
+    while ((size = ::read(m_exportFd, buffer, sizeof(buffer))) > 0)
+        m_exportBuffer.append(buffer, static_cast<int>(size));
+
+    while (m_exportBuffer.size() >= gpioNumberWidth) {
+        m_exports.append(m_exportBuffer.left(gpioNumberWidth).toInt());
+        m_exportBuffer.remove(0, gpioNumberWidth);
+    }
+
+    // Bring up the GPIOs only once all of them have been exported
+    foreach (int gpio, m_expectedExports) {
+        if (!m_exports.contains(gpio))
+            return;
+    }
+
+    foreach (int gpio, m_expectedExports)
+        createGpioDirectory(gpio);
+
+    m_expectedExports.clear();
+}
+
+void GpioConfiguratorTest::createGpioDirectory(int gpio)
+{
+    QDir sysfsDirectory(m_sysfsDirectory.path());
+    QString gpioDirectory = QString("gpio%1").arg(gpio);
+    QVERIFY(sysfsDirectory.mkdir(gpioDirectory));
+
+    foreach (const QString &attribute, QStringList() << "direction" << "value" << "active_low" << "edge") {
+        QFile file(sysfsDirectory.filePath(gpioDirectory + "/" + attribute));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.close();
+    }
+}
+
+void GpioConfiguratorTest::sysfsExportsArePipelined()
+{
+    QList<GpioConfig> configs;
+    for (int i = 0; i < gpioCount; i++) {
+        GpioConfig config;
+        config.gpio = firstGpio + i;
+        config.direction = Gpio::DirectionOutput;
+        config.value = Gpio::ValueHigh;
+        configs.append(config);
+        m_expectedExports.append(config.gpio);
+    }
+
+    QList<Gpio *> gpios;
+    GpioConfigurator configurator;
+    configurator.setExportTimeout(500);
+    connect(&configurator, &GpioConfigurator::gpioConfigured, this, [&gpios](const GpioConfig &config, Gpio *gpio) {
+        Q_UNUSED(config)
+        if (gpio)
+            gpios.append(gpio);
+    });
+
+    QSignalSpy finishedSpy(&configurator, &GpioConfigurator::finished);
+    QVERIFY(configurator.apply(configs));
+    QVERIFY(finishedSpy.wait(5000));
+    QCOMPARE(finishedSpy.first().first().toBool(), true);
+    QCOMPARE(gpios.count(), gpioCount);
+    QCOMPARE(m_exports.count(), gpioCount);
+
+    for (int i = 0; i < gpioCount; i++) {
+        QFile directionFile(m_sysfsDirectory.path() + QString("/gpio%1/direction").arg(firstGpio + i));
+        QVERIFY(directionFile.open(QIODevice::ReadOnly));
+        QCOMPARE(directionFile.readAll().trimmed(), QByteArray("out"));
+
+        QFile valueFile(m_sysfsDirectory.path() + QString("/gpio%1/value").arg(firstGpio + i));
+        QVERIFY(valueFile.open(QIODevice::ReadOnly));
+        QCOMPARE(valueFile.readAll().trimmed(), QByteArray("1"));
+    }
+
+    qDeleteAll(gpios);
+}
+
+QTEST_GUILESS_MAIN(GpioConfiguratorTest)
@@ -0,0 +1,66 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOCONFIGURATORTEST_H
+#define GPIOCONFIGURATORTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QSocketNotifier>
+
+class GpioConfiguratorTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GpioConfiguratorTest(QObject *parent = nullptr);
+
+private:
+    QTemporaryDir m_sysfsDirectory;
+    int m_exportFd = -1;
+    int m_exportKeepAliveFd = -1;
+    QSocketNotifier *m_exportNotifier = nullptr;
+
+    QByteArray m_exportBuffer;
+    QList<int> m_exports;
+    QList<int> m_expectedExports;
+
+    void onExportWritten();
+    void createGpioDirectory(int gpio);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sysfsExportsArePipelined();
+
+};
+
+#endif // GPIOCONFIGURATORTEST_H
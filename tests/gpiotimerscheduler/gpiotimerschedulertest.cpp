@@ -0,0 +1,83 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+    Tests the GpioTimerScheduler with a repeating timer whose interval is not a multiple of the resolution. Rounding
+    the deadline of each period again would make every period last as long as the next multiple of the resolution,
+    the expirations have to stay in phase with the interval instead.
+*/
+
+#include "gpiotimerschedulertest.h"
+#include "gpiotimerscheduler.h"
+
+#include <QtTest>
+
+static const int resolution = 5;
+static const int interval = 7;
+static const int periods = 20;
+
+// Tolerates the wakeup latency of a loaded machine, but not the 3 ms per period a drifting timer accumulates
+static const int latencyTolerance = 20;
+
+GpioTimerSchedulerTest::GpioTimerSchedulerTest(QObject *parent) :
+    QObject(parent)
+{
+
+}
+
+void GpioTimerSchedulerTest::onTimerExpired(void *context)
+{
+    GpioTimerSchedulerTest *test = static_cast<GpioTimerSchedulerTest *>(context);
+    test->m_expirations.append(test->m_clock.elapsed());
+}
+
+void GpioTimerSchedulerTest::repeatingTimerDoesNotDrift()
+{
+    GpioTimerScheduler scheduler;
+    scheduler.setResolution(resolution);
+    int timerId = scheduler.registerTimer(&GpioTimerSchedulerTest::onTimerExpired, this);
+
+    m_expirations.clear();
+    m_clock.start();
+    scheduler.start(timerId, interval, true);
+    QTRY_VERIFY_WITH_TIMEOUT(m_expirations.count() >= periods, 5000);
+    scheduler.stop(timerId);
+
+    for (int i = 0; i < periods; i++) {
+        qint64 nominal = static_cast<qint64>(i + 1) * interval;
+        QVERIFY2(m_expirations.at(i) >= nominal - 1, qPrintable(QString("Period %1 expired early at %2 ms").arg(i + 1).arg(m_expirations.at(i))));
+    }
+
+    qint64 last = m_expirations.at(periods - 1);
+    qint64 nominal = static_cast<qint64>(periods) * interval;
+    QVERIFY2(last <= nominal + resolution + latencyTolerance, qPrintable(QString("Period %1 expired at %2 ms instead of %3 ms").arg(periods).arg(last).arg(nominal)));
+}
+
+QTEST_GUILESS_MAIN(GpioTimerSchedulerTest)